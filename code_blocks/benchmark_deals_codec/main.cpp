@@ -0,0 +1,49 @@
+#include <iostream>
+#include <iomanip>
+#include "easy_bo_data_store.hpp"
+#include <cstdlib>
+
+/* замер сжатия торговых дней бинарного хранилища сделок (FastDealsDataStore)
+ * с разными настройками сжатия
+ * использование: benchmark_deals_codec <хранилище> [дни выборки]
+ */
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cout << "usage: benchmark_deals_codec <fast store> [sample days]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string path(argv[1]);
+    const uint32_t max_days = argc > 2 ? std::atoi(argv[2]) : 30;
+
+    std::vector<easy_bo::DealsCodecConfig> list_config;
+    list_config.push_back(easy_bo::DealsCodecConfig());
+    const int levels[] = {1, 3, 6, 9, 15, 19};
+    for(size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        list_config.push_back(easy_bo::DealsCodecConfig(easy_bo::DealsCodecConfig::CODEC_ZSTD, levels[i]));
+    }
+    list_config.push_back(easy_bo::DealsCodecConfig(easy_bo::DealsCodecConfig::CODEC_ZSTD_LONG, 19));
+
+    easy_bo::FastDealsDataStore store(path);
+    std::cout << "store codec: " << store.get_codec_config().get_name() << std::endl;
+    std::cout << "dictionary id: " << store.get_dictionary_id() << std::endl;
+    std::cout << std::setw(14) << "codec"
+        << std::setw(8) << "days"
+        << std::setw(10) << "ratio"
+        << std::setw(14) << "encode MB/s"
+        << std::setw(14) << "decode MB/s" << std::endl;
+    for(size_t i = 0; i < list_config.size(); ++i) {
+        easy_bo::DealsCodecBenchmark result;
+        int err = store.benchmark_codec(list_config[i], result, max_days);
+        std::cout << std::setw(14) << list_config[i].get_name();
+        if(err != easy_bo::OK) {
+            std::cout << " error: " << err << std::endl;
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(8) << result.days
+            << std::setw(10) << result.ratio
+            << std::setw(14) << result.encode_speed
+            << std::setw(14) << result.decode_speed << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
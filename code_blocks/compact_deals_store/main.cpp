@@ -0,0 +1,32 @@
+#include <iostream>
+#include "easy_bo_data_store.hpp"
+#include <cstdlib>
+
+/* сжатие бинарного хранилища сделок (FastDealsDataStore) с правилами хранения
+ * использование: compact_deals_store <хранилище> [хранимые дни] [удаляемая группа]
+ * хранилище не должно быть открыто другими программами
+ */
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cout << "usage: compact_deals_store <fast store> [keep days] [drop group]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string path(argv[1]);
+    easy_bo::DealsRetentionPolicy policy;
+    if(argc > 2) policy.keep_days(std::atoi(argv[2]));
+    if(argc > 3) policy.drop(easy_bo::DealsQuery().group(std::atoi(argv[3])));
+
+    easy_bo::DealsCompactStats stats;
+    int err = easy_bo::FastDealsDataStore::compact(path, policy, stats);
+    std::cout << "days: " << stats.days_before << " -> " << stats.days_after << std::endl;
+    std::cout << "deals: " << stats.deals_before << " -> " << stats.deals_after << std::endl;
+    std::cout << "bytes: " << stats.bytes_before << " -> " << stats.bytes_after << std::endl;
+    std::cout << "reclaimed bytes: " << stats.get_reclaimed_bytes() << std::endl;
+    std::cout << "scan seconds: " << stats.scan_seconds_before << " -> " << stats.scan_seconds_after << std::endl;
+    std::cout << "seconds: " << stats.seconds << std::endl;
+    if(err != easy_bo::OK) {
+        std::cout << "error: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
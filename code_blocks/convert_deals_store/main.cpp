@@ -0,0 +1,41 @@
+#include <iostream>
+#include "easy_bo_data_store.hpp"
+#include <cstdlib>
+
+/* перенос хранилища сделок JSON (DealsDataStore) в бинарное хранилище (FastDealsDataStore)
+ * использование: convert_deals_store <хранилище JSON> <новое хранилище> [потоки чтения]
+ */
+int main(int argc, char* argv[]) {
+    if(argc < 3) {
+        std::cout << "usage: convert_deals_store <json store> <fast store> [threads]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string source_path(argv[1]);
+    const std::string target_path(argv[2]);
+    const uint32_t threads = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+
+    easy_bo::DealsDataStore source(source_path);
+    easy_bo::FastDealsDataStore target(target_path);
+    easy_bo::DealsConvertStats stats;
+    int err = target.convert_from(source, stats, threads);
+
+    for(size_t i = 0; i < stats.list_days.size(); ++i) {
+        const easy_bo::DealsConvertDay &day = stats.list_days[i];
+        std::cout
+            << xtime::get_str_date(day.timestamp) << " "
+            << day.amount_deals << " "
+            << std::hex << day.source_checksum << " "
+            << day.target_checksum << std::dec << " "
+            << (day.is_verified() ? "ok" : "error") << std::endl;
+    }
+    std::cout << "days: " << stats.days << std::endl;
+    std::cout << "deals: " << stats.deals << std::endl;
+    std::cout << "failed days: " << stats.failed_days << std::endl;
+    std::cout << "seconds: " << stats.seconds << std::endl;
+    if(stats.seconds > 0) std::cout << "deals per second: " << (double)stats.deals / stats.seconds << std::endl;
+    if(err != easy_bo::OK) {
+        std::cout << "error: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
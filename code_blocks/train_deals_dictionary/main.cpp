@@ -0,0 +1,47 @@
+#include <iostream>
+#include "easy_bo_data_store.hpp"
+#include <cstdlib>
+
+/* обучение словаря zstd на бинарном хранилище сделок (FastDealsDataStore)
+ * и перенос сделок в новое хранилище, сжатое с этим словарем
+ * использование: train_deals_dictionary <хранилище> <новое хранилище> [размер словаря] [дни выборки]
+ */
+int main(int argc, char* argv[]) {
+    if(argc < 3) {
+        std::cout << "usage: train_deals_dictionary <fast store> <new fast store> [dictionary size] [sample days]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string source_path(argv[1]);
+    const std::string target_path(argv[2]);
+    const size_t capacity = argc > 3 ? std::atoi(argv[3]) : easy_bo::DealsStorageDictionary::DEFAULT_SIZE;
+    const uint32_t max_days = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    easy_bo::FastDealsDataStore source(source_path);
+    std::string dictionary;
+    int err = source.train_dictionary(dictionary, capacity, max_days);
+    if(err != easy_bo::OK) {
+        std::cout << "train error: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "dictionary size: " << dictionary.size() << std::endl;
+    std::cout << "dictionary id: " << easy_bo::DealsStorageDictionary::get_id(dictionary) << std::endl;
+
+    err = easy_bo::FastDealsDataStore::save_dictionary(target_path, dictionary);
+    if(err != easy_bo::OK) {
+        std::cout << "save dictionary error: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    easy_bo::FastDealsDataStore target(target_path);
+    easy_bo::DealsConvertStats stats;
+    err = target.convert_from(source, stats, std::thread::hardware_concurrency());
+    std::cout << "days: " << stats.days << std::endl;
+    std::cout << "deals: " << stats.deals << std::endl;
+    std::cout << "failed days: " << stats.failed_days << std::endl;
+    std::cout << "seconds: " << stats.seconds << std::endl;
+    if(err != easy_bo::OK) {
+        std::cout << "error: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,502 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_COLUMN_STORAGE_HPP_INCLUDED
+#define EASY_BO_COLUMN_STORAGE_HPP_INCLUDED
+
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+namespace easy_bo {
+
+    /** \brief Класс для хранения сделок одного дня по колонкам
+     *
+     * Каждое поле сделки хранится отдельным непрерывным массивом (колонкой).
+     * Это позволяет при чтении декодировать только нужные колонки, например,
+     * для расчета винрейта достаточно метки времени, длительности и результата.
+     * Ограничение: DailyDataStorage хранит блок колонок дня как один сжатый подфайл,
+     * поэтому день всегда читается с диска и распаковывается zstd целиком. Выбор колонок
+     * экономит только их декодирование и заполнение сделок, но не ввод-вывод и распаковку.
+     * Имена символов хранятся в словаре дня, а колонка имен содержит только индексы словаря.
+     *
+     * Начиная со второй версии формата метки времени хранятся как разности с предыдущей
+     * меткой (zigzag + varint, для отсортированного дня обычно 1 байт на сделку),
+     * а длительности - как индексы в палитре длительностей дня. Блоки первой версии читаются как прежде.
+     */
+    class ColumnDeals {
+    public:
+        /// Набор колонок
+        enum {
+            COLUMN_TIMESTAMP = 0x01,    ///< Метка времени начала бинарного опицона
+            COLUMN_DURATION = 0x02,     ///< Продолжительность бинарного опциона
+            COLUMN_WINRATE = 0x04,      ///< Прогноз винрейта
+            COLUMN_DIRECTION = 0x08,    ///< Направление ставки
+            COLUMN_RESULT = 0x10,       ///< Результат опциона
+            COLUMN_GROUP = 0x20,        ///< Группа сделок
+            COLUMN_SYMBOL = 0x40,       ///< Индекс символа
+            COLUMN_NAME = 0x80,         ///< Имя символа
+            COLUMN_ALL = 0xFF,          ///< Все колонки
+        };
+
+    private:
+        enum {
+            FORMAT_VERSION_RAW = 1,     ///< Метки времени и длительности без упаковки
+            FORMAT_VERSION = 2,         ///< Разности меток времени и палитра длительностей
+            COLUMNS = 8,
+            MAX_PALETTE_SIZE = 255,
+        };
+
+        /** \brief Заголовок блока колонок
+         */
+        struct Header {
+            uint32_t version;           /**< Версия формата */
+            uint32_t amount_deals;      /**< Количество сделок */
+            uint32_t amount_names;      /**< Количество имен в словаре дня */
+            uint32_t offset[COLUMNS];   /**< Смещения колонок от начала блока */
+        };
+
+        std::unique_ptr<uint8_t[]> byte_array;  /**< Массив с данными */
+        size_t byte_array_size = 0;
+
+        /** \brief Получить размер колонки в байтах
+         * \param column Номер колонки
+         * \param amount_deals Количество сделок
+         * \param amount_names Количество имен в словаре дня
+         * \return Размер колонки в байтах
+         */
+        static size_t get_column_size(
+                const size_t column,
+                const size_t amount_deals,
+                const size_t amount_names) {
+            switch(column) {
+            case 0: return amount_deals * sizeof(uint64_t);
+            case 1: return amount_deals * sizeof(uint32_t);
+            case 2: return amount_deals * sizeof(float);
+            case 7: return amount_names * NAME_SIZE + amount_deals * sizeof(uint16_t);
+            default: return amount_deals;
+            }
+        }
+
+        /** \brief Прочитать и проверить заголовок блока
+         * \param header Заголовок блока
+         * \return Вернет true, если заголовок корректен
+         */
+        bool read_header(Header &header) const {
+            if(byte_array_size < sizeof(Header)) return false;
+            std::memcpy(&header, byte_array.get(), sizeof(Header));
+            if(header.version != FORMAT_VERSION && header.version != FORMAT_VERSION_RAW) return false;
+            size_t offset = sizeof(Header);
+            for(size_t c = 0; c < COLUMNS; ++c) {
+                if(header.offset[c] != offset) return false;
+                /* во второй версии размер колонок меток времени и длительностей переменный */
+                if(header.version == FORMAT_VERSION_RAW || c > 1) {
+                    offset += get_column_size(c, header.amount_deals, header.amount_names);
+                } else {
+                    const size_t end = header.offset[c + 1];
+                    if(end < offset || end > byte_array_size) return false;
+                    offset = end;
+                }
+            }
+            return offset == byte_array_size;
+        }
+
+        /** \brief Получить конец колонки
+         * \param header Заголовок блока
+         * \param column Номер колонки
+         * \return Указатель на байт после колонки
+         */
+        inline const uint8_t *get_column_end(const Header &header, const size_t column) const {
+            return byte_array.get() + (column + 1 < COLUMNS ? header.offset[column + 1] : byte_array_size);
+        }
+
+        /** \brief Записать число в формате varint
+         * \param buffer Буфер
+         * \param value Число
+         */
+        static void write_varint(std::vector<uint8_t> &buffer, uint64_t value) {
+            while(value >= 0x80) {
+                buffer.push_back((uint8_t)(value | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back((uint8_t)value);
+        }
+
+        /** \brief Прочитать число в формате varint
+         * \param ptr Указатель на данные, будет сдвинут за прочитанное число
+         * \param end Конец данных
+         * \param value Число
+         * \return Вернет false, если данные закончились
+         */
+        static inline bool read_varint(const uint8_t *&ptr, const uint8_t *end, uint64_t &value) {
+            value = 0;
+            for(uint32_t shift = 0; shift < 64; shift += 7) {
+                if(ptr >= end) return false;
+                const uint8_t byte = *ptr++;
+                value |= (uint64_t)(byte & 0x7F) << shift;
+                if((byte & 0x80) == 0) return true;
+            }
+            return false;
+        }
+
+        /** \brief Упаковать метки времени
+         *
+         * Первая метка хранится относительно начала ее дня, остальные - относительно предыдущей.
+         * Разности кодируются zigzag, поэтому неотсортированные сделки тоже допустимы
+         * \param deals Массив сделок
+         * \param buffer Буфер колонки
+         */
+        static void encode_timestamps(const std::vector<OneDealStruct> &deals, std::vector<uint8_t> &buffer) {
+            buffer.clear();
+            const uint64_t base = xtime::get_first_timestamp_day(deals[0].timestamp);
+            buffer.resize(sizeof(uint64_t));
+            std::memcpy(buffer.data(), &base, sizeof(uint64_t));
+            uint64_t last = base;
+            for(size_t i = 0; i < deals.size(); ++i) {
+                const int64_t delta = (int64_t)((uint64_t)deals[i].timestamp - last);
+                write_varint(buffer, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+                last = deals[i].timestamp;
+            }
+        }
+
+        /** \brief Упаковать длительности
+         *
+         * Если различных длительностей не больше MAX_PALETTE_SIZE, хранится палитра и 1 байт на сделку,
+         * иначе палитра пустая и длительности хранятся как есть
+         * \param deals Массив сделок
+         * \param buffer Буфер колонки
+         */
+        static void encode_durations(const std::vector<OneDealStruct> &deals, std::vector<uint8_t> &buffer) {
+            std::vector<uint32_t> palette;
+            std::vector<uint8_t> indexes(deals.size());
+            for(size_t i = 0; i < deals.size() && palette.size() <= MAX_PALETTE_SIZE; ++i) {
+                auto it = std::find(palette.begin(), palette.end(), deals[i].duration);
+                if(it == palette.end()) {
+                    palette.push_back(deals[i].duration);
+                    it = palette.end() - 1;
+                }
+                indexes[i] = it - palette.begin();
+            }
+            buffer.clear();
+            if(palette.size() > MAX_PALETTE_SIZE) {
+                buffer.resize(1 + deals.size() * sizeof(uint32_t));
+                buffer[0] = 0;
+                for(size_t i = 0; i < deals.size(); ++i) {
+                    std::memcpy(buffer.data() + 1 + i * sizeof(uint32_t), &deals[i].duration, sizeof(uint32_t));
+                }
+                return;
+            }
+            buffer.resize(1 + palette.size() * sizeof(uint32_t));
+            buffer[0] = palette.size();
+            std::memcpy(buffer.data() + 1, palette.data(), palette.size() * sizeof(uint32_t));
+            buffer.insert(buffer.end(), indexes.begin(), indexes.end());
+        }
+
+        /** \brief Распаковать метки времени
+         * \param header Заголовок блока
+         * \param deals Массив сделок
+         * \return Вернет false, если данные повреждены
+         */
+        bool decode_timestamps(const Header &header, std::vector<OneDealStruct> &deals) const {
+            if(header.version == FORMAT_VERSION_RAW) {
+                decode_column<uint64_t>(header, 0, [&](const uint32_t i, const uint64_t v) {
+                    deals[i].timestamp = v;
+                });
+                return true;
+            }
+            const uint8_t *ptr = byte_array.get() + header.offset[0];
+            const uint8_t *end = get_column_end(header, 0);
+            if(end - ptr < (ptrdiff_t)sizeof(uint64_t)) return false;
+            uint64_t last;
+            std::memcpy(&last, ptr, sizeof(uint64_t));
+            ptr += sizeof(uint64_t);
+            for(uint32_t i = 0; i < header.amount_deals; ++i) {
+                uint64_t value;
+                if(!read_varint(ptr, end, value)) return false;
+                last += (uint64_t)((int64_t)(value >> 1) ^ -(int64_t)(value & 1));
+                deals[i].timestamp = last;
+            }
+            return ptr == end;
+        }
+
+        /** \brief Распаковать длительности
+         * \param header Заголовок блока
+         * \param deals Массив сделок
+         * \return Вернет false, если данные повреждены
+         */
+        bool decode_durations(const Header &header, std::vector<OneDealStruct> &deals) const {
+            if(header.version == FORMAT_VERSION_RAW) {
+                decode_column<uint32_t>(header, 1, [&](const uint32_t i, const uint32_t v) {
+                    deals[i].duration = v;
+                });
+                return true;
+            }
+            const uint8_t *ptr = byte_array.get() + header.offset[1];
+            const uint8_t *end = get_column_end(header, 1);
+            if(ptr >= end) return false;
+            const size_t palette_size = *ptr++;
+            if(palette_size == 0) {
+                if((size_t)(end - ptr) != header.amount_deals * sizeof(uint32_t)) return false;
+                for(uint32_t i = 0; i < header.amount_deals; ++i) {
+                    std::memcpy(&deals[i].duration, ptr + i * sizeof(uint32_t), sizeof(uint32_t));
+                }
+                return true;
+            }
+            if((size_t)(end - ptr) != palette_size * sizeof(uint32_t) + header.amount_deals) return false;
+            uint32_t palette[MAX_PALETTE_SIZE];
+            std::memcpy(palette, ptr, palette_size * sizeof(uint32_t));
+            ptr += palette_size * sizeof(uint32_t);
+            for(uint32_t i = 0; i < header.amount_deals; ++i) {
+                if(ptr[i] >= palette_size) return false;
+                deals[i].duration = palette[ptr[i]];
+            }
+            return true;
+        }
+
+        /** \brief Записать колонку
+         * \param header Заголовок блока
+         * \param column Номер колонки
+         * \param deals Массив сделок
+         * \param f Функция, возвращающая значение колонки для сделки
+         */
+        template<class T, class F>
+        void encode_column(
+                const Header &header,
+                const size_t column,
+                const std::vector<OneDealStruct> &deals,
+                F f) {
+            uint8_t *column_ptr = byte_array.get() + header.offset[column];
+            for(size_t i = 0; i < deals.size(); ++i) {
+                const T value = f(deals[i]);
+                std::memcpy(column_ptr + i * sizeof(T), &value, sizeof(T));
+            }
+        }
+
+        /** \brief Прочитать колонку
+         * \param header Заголовок блока
+         * \param column Номер колонки
+         * \param f Функция, принимающая индекс сделки и значение колонки
+         */
+        template<class T, class F>
+        void decode_column(const Header &header, const size_t column, F f) const {
+            const uint8_t *column_ptr = byte_array.get() + header.offset[column];
+            for(uint32_t i = 0; i < header.amount_deals; ++i) {
+                T value;
+                std::memcpy(&value, column_ptr + i * sizeof(T), sizeof(T));
+                f(i, value);
+            }
+        }
+
+    public:
+
+        ColumnDeals() {};
+
+        /* данный код не изменять! он должен остаться без изменений, т.к. нужен для
+         * работы с хранилищем данных.
+         */
+        virtual ColumnDeals & operator = (const ColumnDeals &column_deals) {
+            if(this != &column_deals) {
+                assign(column_deals.data(), column_deals.size());
+            }
+            return *this;
+        }
+
+        ColumnDeals(const ColumnDeals &column_deals) {
+            assign(column_deals.data(), column_deals.size());
+        }
+
+        virtual bool empty() {
+            return (byte_array_size == 0);
+        }
+
+        virtual void assign(const char* s, size_t n) {
+            if(n != byte_array_size) {
+                byte_array = std::unique_ptr<uint8_t[]>(new uint8_t[n]);
+                byte_array_size = n;
+            }
+            char *point = (char*)byte_array.get();
+            std::copy(s, s + n, point);
+        }
+
+        virtual size_t size() const {
+            return byte_array_size;
+        }
+
+        virtual const char* data() const noexcept {
+            return (const char*)byte_array.get();
+        }
+
+        /* дальше пользовательские методы/конструкторы */
+
+        /** \brief Получить количество сделок
+         * \return Количество сделок
+         */
+        uint32_t get_amount_deals() const {
+            Header header;
+            if(!read_header(header)) return 0;
+            return header.amount_deals;
+        }
+
+        /** \brief Записать вектор сделок
+         * \param deals Массив сделок
+         * \return Вернет false, если в словаре дня больше 65535 имен
+         */
+        bool set_vector(const std::vector<OneDealStruct> &deals) {
+            if(deals.size() == 0) {
+                byte_array.reset();
+                byte_array_size = 0;
+                return true;
+            }
+
+            /* составляем словарь имен дня */
+            std::vector<std::string> names;
+            std::map<std::string, uint16_t> names_index;
+            std::vector<uint16_t> name_column(deals.size());
+            for(size_t i = 0; i < deals.size(); ++i) {
+                const std::string name((const char*)deals[i].name, NAME_SIZE);
+                auto it = names_index.find(name);
+                if(it != names_index.end()) {
+                    name_column[i] = it->second;
+                    continue;
+                }
+                if(names.size() > std::numeric_limits<uint16_t>::max()) return false;
+                const uint16_t index = names.size();
+                names_index[name] = index;
+                names.push_back(name);
+                name_column[i] = index;
+            }
+
+            std::vector<uint8_t> timestamp_column, duration_column;
+            encode_timestamps(deals, timestamp_column);
+            encode_durations(deals, duration_column);
+
+            Header header;
+            header.version = FORMAT_VERSION;
+            header.amount_deals = deals.size();
+            header.amount_names = names.size();
+            size_t offset = sizeof(Header);
+            for(size_t c = 0; c < COLUMNS; ++c) {
+                header.offset[c] = offset;
+                if(c == 0) offset += timestamp_column.size();
+                else if(c == 1) offset += duration_column.size();
+                else offset += get_column_size(c, header.amount_deals, header.amount_names);
+            }
+            if(offset != byte_array_size) {
+                byte_array = std::unique_ptr<uint8_t[]>(new uint8_t[offset]);
+                byte_array_size = offset;
+            }
+            std::memcpy(byte_array.get(), &header, sizeof(Header));
+
+            std::memcpy(byte_array.get() + header.offset[0], timestamp_column.data(), timestamp_column.size());
+            std::memcpy(byte_array.get() + header.offset[1], duration_column.data(), duration_column.size());
+            encode_column<float>(header, 2, deals, [](const OneDealStruct &d) {return d.winrate;});
+            encode_column<int8_t>(header, 3, deals, [](const OneDealStruct &d) {return d.direction;});
+            encode_column<int8_t>(header, 4, deals, [](const OneDealStruct &d) {return d.result;});
+            encode_column<uint8_t>(header, 5, deals, [](const OneDealStruct &d) {return d.group;});
+            encode_column<uint8_t>(header, 6, deals, [](const OneDealStruct &d) {return d.symbol;});
+
+            /* колонка имен: сначала словарь, затем индексы */
+            uint8_t *names_ptr = byte_array.get() + header.offset[7];
+            for(size_t n = 0; n < names.size(); ++n) {
+                std::memcpy(names_ptr + n * NAME_SIZE, names[n].data(), NAME_SIZE);
+            }
+            std::memcpy(
+                names_ptr + names.size() * NAME_SIZE,
+                name_column.data(),
+                name_column.size() * sizeof(uint16_t));
+            return true;
+        }
+
+        /** \brief Получить вектор сделок
+         *
+         * Колонки, которые не были запрошены, останутся со значениями по умолчанию
+         * \param deals Массив сделок
+         * \param columns Набор колонок для декодирования, например COLUMN_TIMESTAMP | COLUMN_RESULT
+         * \return Вернет false, если данные повреждены
+         */
+        bool get_vector(std::vector<OneDealStruct> &deals, const uint32_t columns = COLUMN_ALL) const {
+            deals.clear();
+            if(byte_array_size == 0) return true;
+            Header header;
+            if(!read_header(header)) return false;
+            deals.resize(header.amount_deals);
+
+            if((columns & COLUMN_TIMESTAMP) && !decode_timestamps(header, deals)) {
+                deals.clear();
+                return false;
+            }
+            if((columns & COLUMN_DURATION) && !decode_durations(header, deals)) {
+                deals.clear();
+                return false;
+            }
+            if(columns & COLUMN_WINRATE) {
+                decode_column<float>(header, 2, [&](const uint32_t i, const float v) {
+                    deals[i].winrate = v;
+                });
+            }
+            if(columns & COLUMN_DIRECTION) {
+                decode_column<int8_t>(header, 3, [&](const uint32_t i, const int8_t v) {
+                    deals[i].direction = v;
+                });
+            }
+            if(columns & COLUMN_RESULT) {
+                decode_column<int8_t>(header, 4, [&](const uint32_t i, const int8_t v) {
+                    deals[i].result = v;
+                });
+            }
+            if(columns & COLUMN_GROUP) {
+                decode_column<uint8_t>(header, 5, [&](const uint32_t i, const uint8_t v) {
+                    deals[i].group = v;
+                });
+            }
+            if(columns & COLUMN_SYMBOL) {
+                decode_column<uint8_t>(header, 6, [&](const uint32_t i, const uint8_t v) {
+                    deals[i].symbol = v;
+                });
+            }
+            if(columns & COLUMN_NAME) {
+                const uint8_t *names_ptr = byte_array.get() + header.offset[7];
+                const uint8_t *index_ptr = names_ptr + header.amount_names * NAME_SIZE;
+                for(uint32_t i = 0; i < header.amount_deals; ++i) {
+                    uint16_t index;
+                    std::memcpy(&index, index_ptr + i * sizeof(uint16_t), sizeof(uint16_t));
+                    if(index >= header.amount_names) {
+                        deals.clear();
+                        return false;
+                    }
+                    std::memcpy(deals[i].name, names_ptr + index * NAME_SIZE, NAME_SIZE);
+                }
+            }
+            return true;
+        }
+    };
+
+    typedef xquotes_daily_data_storage::
+        DailyDataStorage<ColumnDeals> ColumnDealsStorage; /**< Хранилище сделок по колонкам */
+};
+
+#endif // EASY_BO_COLUMN_STORAGE_HPP_INCLUDED
@@ -0,0 +1,307 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_COMPACT_STORAGE_HPP_INCLUDED
+#define EASY_BO_COMPACT_STORAGE_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+#include <limits>
+#include <cstring>
+#include <cstdio>
+
+namespace easy_bo {
+
+    /** \brief Класс словаря символов хранилища
+     *
+     * Сопоставляет имени символа компактный идентификатор. Словарь хранится
+     * в отдельном файле рядом с хранилищем и записывается только при появлении новых символов.
+     */
+    class SymbolDictionary {
+    public:
+        static const uint32_t FILE_MAGIC = 0x53594245;  /**< Сигнатура файла "EBYS" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+        static const uint16_t NO_SYMBOL = 0xFFFF;       /**< Идентификатор отсутствующего символа */
+
+    private:
+        std::vector<std::string> list_names;            /**< Имена символов по идентификаторам */
+        std::map<std::string, uint16_t> names_index;    /**< Идентификаторы символов по именам */
+        bool is_modified = false;
+
+        /** \brief Получить ключ имени
+         * \param name Буфер имени символа
+         * \return Ключ имени, совпадающий для одинаковых буферов
+         */
+        static inline std::string get_key(const int8_t *name) {
+            return std::string((const char*)name, NAME_SIZE);
+        }
+
+    public:
+        SymbolDictionary() {};
+
+        /** \brief Получить идентификатор символа, добавив символ в словарь при необходимости
+         * \param name Буфер имени символа размером NAME_SIZE
+         * \return Идентификатор символа или NO_SYMBOL, если словарь переполнен
+         */
+        uint16_t add_symbol(const int8_t *name) {
+            const std::string key = get_key(name);
+            auto it = names_index.find(key);
+            if(it != names_index.end()) return it->second;
+            if(list_names.size() >= NO_SYMBOL) return NO_SYMBOL;
+            const uint16_t id = list_names.size();
+            list_names.push_back(key);
+            names_index[key] = id;
+            is_modified = true;
+            return id;
+        }
+
+        /** \brief Найти идентификатор символа
+         * \param name Буфер имени символа размером NAME_SIZE
+         * \return Идентификатор символа или NO_SYMBOL, если символа нет в словаре
+         */
+        uint16_t find_symbol(const int8_t *name) const {
+            auto it = names_index.find(get_key(name));
+            if(it == names_index.end()) return NO_SYMBOL;
+            return it->second;
+        }
+
+        /** \brief Найти идентификатор символа
+         * \param symbol_name Имя символа
+         * \return Идентификатор символа или NO_SYMBOL, если символа нет в словаре
+         */
+        uint16_t find_symbol(const std::string &symbol_name) const {
+            OneDealStruct deal;
+            deal.set_name(symbol_name);
+            return find_symbol(deal.name);
+        }
+
+        /** \brief Получить буфер имени символа
+         * \param id Идентификатор символа
+         * \return Указатель на буфер имени размером NAME_SIZE или nullptr
+         */
+        inline const int8_t *get_name_buffer(const uint16_t id) const {
+            if(id >= list_names.size()) return nullptr;
+            return (const int8_t*)list_names[id].data();
+        }
+
+        /** \brief Получить имя символа
+         * \param id Идентификатор символа
+         * \return Имя символа или пустая строка
+         */
+        std::string get_name(const uint16_t id) const {
+            const int8_t *name = get_name_buffer(id);
+            if(name == nullptr) return std::string();
+            OneDealStruct deal;
+            std::memcpy(deal.name, name, NAME_SIZE);
+            return deal.get_name();
+        }
+
+        inline size_t size() const {return list_names.size();};
+        inline bool modified() const {return is_modified;};
+
+        /** \brief Загрузить словарь из файла
+         * \param path Путь к файлу словаря
+         * \return Вернет 0 в случае успеха
+         */
+        int load(const std::string &path) {
+            list_names.clear();
+            names_index.clear();
+            is_modified = false;
+            std::ifstream file(path, std::ios::binary);
+            if(!file) return NO_DATA_ACCESS;
+            uint32_t header[3] = {};
+            if(!file.read((char*)header, sizeof(header))) return PARSER_ERROR;
+            if(header[0] != FILE_MAGIC || header[1] != FILE_VERSION || header[2] > NO_SYMBOL) return PARSER_ERROR;
+            std::vector<char> buffer(header[2] * NAME_SIZE);
+            if(buffer.size() > 0 && !file.read(buffer.data(), buffer.size())) return PARSER_ERROR;
+            for(uint32_t i = 0; i < header[2]; ++i) {
+                const std::string key(buffer.data() + i * NAME_SIZE, NAME_SIZE);
+                names_index[key] = list_names.size();
+                list_names.push_back(key);
+            }
+            return OK;
+        }
+
+        /** \brief Записать словарь в файл
+         *
+         * Словарь записывается во временный файл, который затем заменяет старый
+         * \param path Путь к файлу словаря
+         * \return Вернет 0 в случае успеха
+         */
+        int save(const std::string &path) {
+            const std::string temp_path = path + ".tmp";
+            {
+                std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+                if(!file) return NO_DATA_ACCESS;
+                const uint32_t header[3] = {FILE_MAGIC, FILE_VERSION, (uint32_t)list_names.size()};
+                file.write((const char*)header, sizeof(header));
+                for(size_t i = 0; i < list_names.size(); ++i) {
+                    file.write(list_names[i].data(), NAME_SIZE);
+                }
+                if(!file) return NO_DATA_ACCESS;
+            }
+            std::remove(path.c_str());
+            if(std::rename(temp_path.c_str(), path.c_str()) != 0) return NO_DATA_ACCESS;
+            is_modified = false;
+            return OK;
+        }
+    };
+
+    /** \brief Класс компактной записи сделки
+     *
+     * Вместо имени символа хранит идентификатор из словаря символов хранилища
+     */
+    class CompactDealStruct {
+    public:
+        xtime::timestamp_t timestamp = 0;   /**< Метка времени начала бинарного опицона */
+        uint32_t duration = 0;              /**< Продолжительность бинарного опциона в секундах */
+        float winrate = 0;                  /**< Прогноз винрейта */
+        int8_t direction = EASY_BO_NO_BET;  /**< Направление ставки, покупка или продажа опциона */
+        int8_t result = EASY_BO_NEUTRAL;    /**< Результат опциона, победа или поражение */
+        uint8_t group = 0;                  /**< Группа сделок */
+        uint8_t symbol = 0;                 /**< Индекс символа */
+        uint16_t name_id = 0;               /**< Идентификатор имени символа в словаре */
+        uint16_t reserved = 0;              /**< Не используется, обнулен */
+
+        CompactDealStruct() {};
+    };
+
+    /** \brief Класс массива компактных сделок одного дня
+     */
+    class CompactArrayDeals {
+    private:
+        std::vector<CompactDealStruct> deals;
+
+    public:
+        CompactArrayDeals() {};
+
+        /* данный код не изменять! он должен остаться без изменений, т.к. нужен для
+         * работы с хранилищем данных.
+         */
+        virtual CompactArrayDeals & operator = (const CompactArrayDeals &array_deals) {
+            if(this != &array_deals) deals = array_deals.deals;
+            return *this;
+        }
+
+        CompactArrayDeals(const CompactArrayDeals &array_deals) : deals(array_deals.deals) {};
+
+        virtual bool empty() {
+            return deals.empty();
+        }
+
+        virtual void assign(const char* s, size_t n) {
+            deals.resize(n / sizeof(CompactDealStruct));
+            if(deals.size() > 0) std::memcpy((char*)deals.data(), s, deals.size() * sizeof(CompactDealStruct));
+        }
+
+        virtual size_t size() const {
+            return deals.size() * sizeof(CompactDealStruct);
+        }
+
+        virtual const char* data() const noexcept {
+            return (const char*)deals.data();
+        }
+
+        /* дальше пользовательские методы/конструкторы */
+
+        /** \brief Получить количество сделок
+         * \return Количество сделок
+         */
+        inline uint32_t get_amount_deals() const {
+            return deals.size();
+        }
+
+        /** \brief Получить сделку по индексу
+         * \return Ссылка на сделку
+         */
+        inline const CompactDealStruct &get_deal(const uint32_t deal_index) const {
+            return deals[deal_index];
+        }
+
+        /** \brief Записать вектор сделок
+         *
+         * Новые символы добавляются в словарь
+         * \param list_deals Массив сделок
+         * \param dictionary Словарь символов хранилища
+         * \return Вернет false, если словарь переполнен
+         */
+        bool set_vector(const std::vector<OneDealStruct> &list_deals, SymbolDictionary &dictionary) {
+            deals.resize(list_deals.size());
+            for(size_t i = 0; i < list_deals.size(); ++i) {
+                const OneDealStruct &src = list_deals[i];
+                CompactDealStruct &dst = deals[i];
+                dst.timestamp = src.timestamp;
+                dst.duration = src.duration;
+                dst.winrate = src.winrate;
+                dst.direction = src.direction;
+                dst.result = src.result;
+                dst.group = src.group;
+                dst.symbol = src.symbol;
+                dst.name_id = dictionary.add_symbol(src.name);
+                if(dst.name_id == SymbolDictionary::NO_SYMBOL) return false;
+            }
+            return true;
+        }
+
+        /** \brief Получить вектор сделок
+         * \param list_deals Массив сделок
+         * \param dictionary Словарь символов хранилища
+         * \param is_name Заполнять имена символов
+         * \return Вернет false, если идентификатора символа нет в словаре
+         */
+        bool get_vector(
+                std::vector<OneDealStruct> &list_deals,
+                const SymbolDictionary &dictionary,
+                const bool is_name = true) const {
+            list_deals.resize(deals.size());
+            for(size_t i = 0; i < deals.size(); ++i) {
+                const CompactDealStruct &src = deals[i];
+                OneDealStruct &dst = list_deals[i];
+                dst.timestamp = src.timestamp;
+                dst.duration = src.duration;
+                dst.winrate = src.winrate;
+                dst.direction = src.direction;
+                dst.result = src.result;
+                dst.group = src.group;
+                dst.symbol = src.symbol;
+                if(!is_name) continue;
+                const int8_t *name = dictionary.get_name_buffer(src.name_id);
+                if(name == nullptr) {
+                    list_deals.clear();
+                    return false;
+                }
+                std::memcpy(dst.name, name, NAME_SIZE);
+            }
+            return true;
+        }
+    };
+
+    typedef xquotes_daily_data_storage::
+        DailyDataStorage<CompactArrayDeals> CompactDealsStorage; /**< Хранилище компактных сделок */
+};
+
+#endif // EASY_BO_COMPACT_STORAGE_HPP_INCLUDED
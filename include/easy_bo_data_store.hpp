@@ -29,15 +29,112 @@
 #include <limits>
 #include <type_traits>
 #include <list>
+#include <chrono>
+#include <memory>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "easy_bo_common.hpp"
 #include "easy_bo_simplifed_tester.hpp"
 #include "easy_bo_fast_storage.hpp"
+#include "easy_bo_column_storage.hpp"
+#include "easy_bo_mapped_storage.hpp"
+#include "easy_bo_compact_storage.hpp"
+#include "easy_bo_day_cache.hpp"
+#include "easy_bo_day_summary.hpp"
+#include "easy_bo_symbol_catalog.hpp"
+#include "easy_bo_deals_query.hpp"
+#include "easy_bo_deals_journal.hpp"
+#include "easy_bo_deals_ingest.hpp"
+#include "easy_bo_storage_dictionary.hpp"
+#include "easy_bo_deals_codec.hpp"
+#include "easy_bo_days_calendar.hpp"
+#include "easy_bo_deals_retention.hpp"
+#include "easy_bo_write_cache.hpp"
 #include "xquotes_json_storage.hpp"
 #include "xtime.hpp"
 
 namespace easy_bo {
 
+	/** \brief Класс статистики записи сделок в хранилище
+	 */
+	class DealsIngestStats {
+	public:
+		uint64_t deals = 0;         /**< Количество принятых сделок */
+		uint64_t repeat_deals = 0;  /**< Количество отброшенных повторяющихся сделок */
+		uint64_t days = 0;          /**< Количество записанных в хранилище дней */
+		double seconds = 0;         /**< Время, затраченное на пакетную запись сделок */
+
+		/** \brief Получить скорость записи сделок
+		 * \return Количество сделок в секунду
+		 */
+		inline double get_deals_per_second() const {
+			return seconds > 0 ? (double)deals / seconds : 0.0;
+		}
+	};
+
+	/** \brief Получить контрольную сумму сделок дня
+	 *
+	 * Учитываются поля, которые сохраняют все типы хранилищ: имя, индекс символа, группа,
+	 * направление, результат, длительность и метка времени. Порядок сделок учитывается
+	 * \param list_deals Массив сделок
+	 * \return Контрольная сумма FNV-1a
+	 */
+	inline uint32_t get_deals_checksum(const std::vector<OneDealStruct> &list_deals) {
+		uint32_t hash = 2166136261UL;
+		auto update = [&hash](const void *data, const size_t size) {
+			const uint8_t *ptr = (const uint8_t*)data;
+			for(size_t i = 0; i < size; ++i) {
+				hash ^= ptr[i];
+				hash *= 16777619UL;
+			}
+		};
+		for(size_t i = 0; i < list_deals.size(); ++i) {
+			const OneDealStruct &deal = list_deals[i];
+			const uint64_t timestamp = deal.timestamp;
+			update(deal.name, NAME_SIZE);
+			update(&timestamp, sizeof(timestamp));
+			update(&deal.duration, sizeof(deal.duration));
+			update(&deal.direction, sizeof(deal.direction));
+			update(&deal.result, sizeof(deal.result));
+			update(&deal.group, sizeof(deal.group));
+			update(&deal.symbol, sizeof(deal.symbol));
+		}
+		return hash;
+	}
+
+	/** \brief Класс отчета о переносе торгового дня между хранилищами
+	 */
+	class DealsConvertDay {
+	public:
+		xtime::timestamp_t timestamp = 0;   /**< Метка времени начала дня */
+		uint32_t amount_deals = 0;          /**< Количество сделок дня в исходном хранилище */
+		uint32_t source_checksum = 0;       /**< Контрольная сумма сделок исходного хранилища */
+		uint32_t target_checksum = 0;       /**< Контрольная сумма сделок, прочитанных из нового хранилища */
+		int err = OK;                       /**< Код ошибки записи дня */
+
+		/** \brief Проверить, совпадают ли сделки дня в обоих хранилищах
+		 * \return Вернет true, если день записан без ошибок и контрольные суммы совпали
+		 */
+		inline bool is_verified() const {
+			return err == OK && source_checksum == target_checksum;
+		}
+	};
+
+	/** \brief Класс статистики переноса сделок между хранилищами
+	 */
+	class DealsConvertStats {
+	public:
+		uint64_t days = 0;                      /**< Количество перенесенных дней */
+		uint64_t deals = 0;                     /**< Количество перенесенных сделок */
+		uint64_t failed_days = 0;               /**< Количество дней, записанных с ошибкой или не прошедших проверку */
+		double seconds = 0;                     /**< Время переноса */
+		std::vector<DealsConvertDay> list_days; /**< Отчет по каждому дню */
+	};
+
 	/** \brief Класс хранилища сделок
 	 */
     template<class STORAGE_TYPE = xquotes_json_storage::JsonStorage>
@@ -72,9 +169,308 @@ namespace easy_bo {
     typedef OneDealStruct Deal;
 
 	private:
-		std::vector<Deal> list_write_deals;	/**< Массив сделок */
-		STORAGE_TYPE iStorage;	                /**< Хранилище данных сделок, разбитых по дням */
-        xtime::timestamp_t date_timestamp = 0;  /**< Метка времени начала исторических данных */
+
+		/** \brief Класс последовательного чтения торговых дней
+		 *
+		 * Дни выдаются строго по порядку списка. Если включено упреждающее чтение (см. set_prefetch),
+		 * дни, которых нет в кэше, декодируются заранее в рабочих потоках.
+		 * Каждый поток открывает собственный экземпляр хранилища, число декодированных,
+		 * но еще не выданных дней ограничено глубиной очереди.
+		 * Потоки видят только сохраненный файл, поэтому дни, измененные после сохранения, и дни буфера записи
+		 * читаются без упреждения. Запись в хранилище останавливает потоки (см. stop_workers)
+		 */
+		class DaysReader {
+		private:
+			DealsDataStoreTemplate *store;
+			std::vector<xtime::timestamp_t> list_days;  /**< Метки времени дней в порядке чтения */
+			std::vector<bool> list_prefetch;            /**< Флаги дней, декодируемых в рабочих потоках */
+			uint32_t columns;
+			size_t day_index = 0;
+
+			std::vector<size_t> list_tasks;             /**< Индексы дней для рабочих потоков */
+			std::map<size_t, std::pair<int, std::vector<Deal>>> list_ready; /**< Декодированные дни по номеру задачи */
+			std::vector<std::vector<Deal>> list_free;   /**< Освободившиеся массивы сделок для повторного использования */
+			size_t task_index = 0;                      /**< Следующая задача для рабочего потока */
+			size_t consumed_tasks = 0;                  /**< Количество выданных задач */
+			size_t depth = 0;
+			bool is_stop = false;
+			std::mutex tasks_mutex;
+			std::condition_variable tasks_cv;
+			std::vector<std::thread> workers;
+
+			void worker() {
+				DictionaryStorage<STORAGE_TYPE> storage(store->store_path, store->get_storage_dictionary());
+				std::vector<Deal> deals;
+				while(true) {
+					size_t task = 0;
+					{
+						std::unique_lock<std::mutex> lock(tasks_mutex);
+						tasks_cv.wait(lock, [&]() {
+							return is_stop ||
+								task_index >= list_tasks.size() ||
+								task_index < (consumed_tasks + depth);
+						});
+						if(is_stop || task_index >= list_tasks.size()) return;
+						task = task_index++;
+						if(!list_free.empty()) {
+							deals.swap(list_free.back());
+							list_free.pop_back();
+						}
+					}
+					int err = store->template read_deals<STORAGE_TYPE>(
+						storage,
+						deals,
+						list_days[list_tasks[task]],
+						columns);
+					if(err == OK) store->sort_list_deals(deals);
+					{
+						std::lock_guard<std::mutex> lock(tasks_mutex);
+						list_ready[task] = std::make_pair(err, std::move(deals));
+					}
+					deals = std::vector<Deal>();
+					tasks_cv.notify_all();
+				}
+			}
+
+			void start_workers() {
+				const size_t threads = std::min((size_t)store->prefetch_threads, list_tasks.size());
+				for(size_t i = 0; i < threads; ++i) {
+					workers.push_back(std::thread(&DaysReader::worker, this));
+				}
+			}
+
+		public:
+
+			/** \brief Инициализировать чтение дней
+			 * \param data_store Хранилище сделок
+			 * \param days Метки времени дней в порядке чтения
+			 * \param user_columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+			 */
+			DaysReader(
+					DealsDataStoreTemplate *data_store,
+					const std::vector<xtime::timestamp_t> &days,
+					const uint32_t user_columns) :
+					store(data_store),
+					list_days(days),
+					list_prefetch(days.size(), false),
+					columns(user_columns | ColumnDeals::COLUMN_TIMESTAMP) {
+				/* сделки хранилища, отображенного в память, копируются без декодирования,
+				 * а отдельные потоки могли бы открыть другой снимок хранилища
+				 */
+				if(store->prefetch_threads == 0 ||
+					std::is_same<STORAGE_TYPE, MappedDealsStorage>::value) return;
+				depth = std::max(store->prefetch_depth, (uint32_t)1);
+				for(size_t i = 0; i < list_days.size(); ++i) {
+					if(store->day_cache.check(list_days[i], columns)) continue;
+					if(store->check_unsaved_day(list_days[i])) continue;
+					list_prefetch[i] = true;
+					list_tasks.push_back(i);
+				}
+				if(!list_tasks.empty()) store->list_readers.insert(this);
+			}
+
+			DaysReader(const DaysReader &) = delete;
+			DaysReader &operator=(const DaysReader &) = delete;
+
+			~DaysReader() {
+				stop_workers();
+				store->list_readers.erase(this);
+			}
+
+			/** \brief Остановить рабочие потоки
+			 *
+			 * Вызывается перед записью в хранилище: оставшиеся дни будут прочитаны без упреждения,
+			 * уже декодированные потоками дни отбрасываются
+			 */
+			void stop_workers() {
+				{
+					std::lock_guard<std::mutex> lock(tasks_mutex);
+					is_stop = true;
+				}
+				tasks_cv.notify_all();
+				for(size_t i = 0; i < workers.size(); ++i) {
+					workers[i].join();
+				}
+				workers.clear();
+				list_ready.clear();
+				list_tasks.clear();
+				for(size_t i = day_index; i < list_prefetch.size(); ++i) {
+					list_prefetch[i] = false;
+				}
+			}
+
+			/** \brief Получить количество дней
+			 * \return Количество дней
+			 */
+			inline size_t size() const {return list_days.size();};
+
+			/** \brief Проверить, прочитаны ли все дни
+			 * \return Вернет true, если дней больше нет
+			 */
+			inline bool end() const {return day_index >= list_days.size();};
+
+			/** \brief Прочитать следующий день
+			 * \param deals Отсортированные по времени сделки дня
+			 * \param timestamp Метка времени начала дня
+			 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+			 */
+			int read(std::vector<Deal> &deals, xtime::timestamp_t &timestamp) {
+				if(day_index >= list_days.size()) return NO_DATA_ACCESS;
+				const size_t index = day_index++;
+				timestamp = list_days[index];
+				if(!list_prefetch[index]) return store->read_day_deals(deals, timestamp, columns);
+				if(workers.empty()) start_workers();
+				int err = OK;
+				{
+					std::unique_lock<std::mutex> lock(tasks_mutex);
+					tasks_cv.wait(lock, [&]() {
+						return list_ready.find(consumed_tasks) != list_ready.end();
+					});
+					auto it = list_ready.find(consumed_tasks);
+					err = it->second.first;
+					deals.swap(it->second.second);
+					/* прежний массив вызывающего кода пойдет на чтение следующих дней */
+					if(it->second.second.capacity() > 0) list_free.push_back(std::move(it->second.second));
+					list_ready.erase(it);
+					++consumed_tasks;
+				}
+				tasks_cv.notify_all();
+				if(err == OK) store->day_cache.put(deals, timestamp, columns);
+				return err;
+			}
+		};
+
+	public:
+
+		/// Режимы торговли методом trade, можно объединять
+		enum {
+			TRADE_EXACT_TIMESTAMP = 0x00,   ///< Передавать сделки, метка времени которых совпадает с началом шага
+			TRADE_BUCKETS = 0x01,           ///< Передавать все сделки интервала шага
+			TRADE_EMPTY_SLOTS = 0x02,       ///< Вызывать обработчик и для шагов без сделок
+		};
+
+		/** \brief Курсор сделок хранилища
+		 *
+		 * Последовательно читает сделки по дням, в памяти находится только один торговый день
+		 * (и дни очереди упреждающего чтения, если оно включено).
+		 * При движении вперед дни и сделки идут по возрастанию времени, при движении назад - по убыванию.
+		 * Сделки, начатые раньше начальной метки времени или закончившиеся позже конечной, пропускаются
+		 */
+		class DealsCursor {
+		public:
+			enum {
+				FORWARD = 0,    ///< От начальной даты к конечной
+				BACKWARD = 1,   ///< От конечной даты к начальной
+			};
+
+		private:
+			std::shared_ptr<DaysReader> days_reader;
+			xtime::timestamp_t start_timestamp = 0;     /**< Начальная метка времени сделок */
+			xtime::timestamp_t stop_timestamp = 0;      /**< Максимальное время окончания сделок */
+			int direction = FORWARD;
+			std::function<void(std::vector<Deal> &deals)> callback;
+			DealsQuery query;                           /**< Условия отбора сделок */
+			std::vector<Deal> list_deals;               /**< Сделки текущего дня */
+			size_t deal_index = 0;
+
+		public:
+			DealsCursor() {};
+
+			/** \brief Инициализировать курсор
+			 * \param data_store Хранилище сделок
+			 * \param start Начальная метка времени
+			 * \param stop Конечная метка времени
+			 * \param cursor_direction Направление движения курсора
+			 * \param user_callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок дня
+			 * \param user_columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+			 * \param user_query Условия отбора сделок, проверяются до вызова user_callback
+			 */
+			DealsCursor(
+					DealsDataStoreTemplate *data_store,
+					const xtime::timestamp_t start,
+					const xtime::timestamp_t stop,
+					const int cursor_direction = FORWARD,
+					std::function<void(std::vector<Deal> &deals)> user_callback = nullptr,
+					const uint32_t user_columns = ColumnDeals::COLUMN_ALL,
+					const DealsQuery &user_query = DealsQuery()) :
+					start_timestamp(start),
+					stop_timestamp(stop),
+					direction(cursor_direction),
+					callback(user_callback),
+					query(user_query) {
+				std::vector<xtime::timestamp_t> days;
+				data_store->get_calendar().get_days(days, start, stop);
+				if(direction == BACKWARD) std::reverse(days.begin(), days.end());
+				days_reader = std::make_shared<DaysReader>(
+					data_store,
+					days,
+					user_columns | query.get_columns() | ColumnDeals::COLUMN_TIMESTAMP | ColumnDeals::COLUMN_DURATION);
+			}
+
+			/** \brief Получить сделки следующего торгового дня
+			 *
+			 * Дни без сделок пропускаются. Сделки дня всегда отсортированы по возрастанию времени
+			 * \param deals Сделки дня
+			 * \param timestamp Метка времени начала дня
+			 * \return Вернет false, если дни закончились
+			 */
+			bool next_day(std::vector<Deal> &deals, xtime::timestamp_t &timestamp) {
+				while(days_reader && !days_reader->end()) {
+					if(days_reader->read(deals, timestamp) != OK) continue;
+					/* границы времени и условия запроса проверяются за один проход */
+					const xtime::timestamp_t start = start_timestamp;
+					const xtime::timestamp_t stop = stop_timestamp;
+					const DealsQuery &day_query = query;
+					deals.erase(std::remove_if(deals.begin(), deals.end(), [start, stop, &day_query](const Deal &deal) {
+						return deal.timestamp < start ||
+							(deal.timestamp + deal.duration) > stop ||
+							!day_query.check(deal);
+					}), deals.end());
+					if(deals.size() != 0 && callback != nullptr) callback(deals);
+					if(deals.size() != 0) return true;
+				}
+				deals.clear();
+				return false;
+			}
+
+			/** \brief Получить следующую сделку
+			 * \param deal Сделка
+			 * \return Вернет false, если сделки закончились
+			 */
+			bool next(Deal &deal) {
+				while(deal_index >= list_deals.size()) {
+					xtime::timestamp_t timestamp = 0;
+					deal_index = 0;
+					if(!next_day(list_deals, timestamp)) return false;
+				}
+				if(direction == FORWARD) deal = list_deals[deal_index];
+				else deal = list_deals[list_deals.size() - 1 - deal_index];
+				++deal_index;
+				return true;
+			}
+		};
+
+	private:
+		std::string storage_dictionary;         /**< Словарь zstd хранилища, должен быть объявлен до iStorage */
+		DealsCodec codec;                       /**< Сжатие торговых дней, должно быть объявлено до iStorage */
+		DictionaryStorage<STORAGE_TYPE> iStorage; /**< Хранилище данных сделок, разбитых по дням */
+		std::string store_path;                 /**< Путь к хранилищу */
+		SymbolDictionary symbol_dictionary;     /**< Словарь символов хранилища */
+        DealsWriteCache write_cache;            /**< Буфер записи торговых дней */
+        bool is_allow_duplicates = false;       /**< Запись без проверки сделок на повторы */
+        DealsIngestStats ingest_stats;          /**< Статистика записи сделок */
+        DealsDayCache day_cache;                /**< Кэш декодированных торговых дней */
+        DealsCalendar calendar;                 /**< Календарь дней хранилища, строится при первом запросе */
+        uint32_t prefetch_threads = 0;          /**< Количество потоков упреждающего чтения дней */
+        uint32_t prefetch_depth = 0;            /**< Максимальное количество заранее декодированных дней */
+        std::unique_ptr<DaySummaryStorage> iSummaryStorage; /**< Хранилище итогов торговых дней */
+        SymbolCatalog symbol_catalog;           /**< Каталог символов хранилища */
+        bool is_symbol_catalog = false;         /**< Флаг актуальности каталога символов */
+        DealsJournal journal;                   /**< Журнал сделок, еще не сохраненных в хранилище */
+        bool is_journal = false;                /**< Флаг записи добавляемых сделок в журнал */
+        std::set<xtime::timestamp_t> snapshot_days; /**< Дни, измененные после публикации снимка */
+        std::set<xtime::timestamp_t> unsaved_days;  /**< Дни, записанные после сохранения хранилища */
+        std::set<DaysReader*> list_readers;         /**< Чтения дней с рабочими потоками */
 
 		/** \brief Записать сделки за один торговый день
          * \param list_deals Список сделок
@@ -103,22 +499,78 @@ namespace easy_bo {
          */
         template<typename T, typename std::enable_if<std::is_same<T, ArrayDealsStorage>::value>::type* = nullptr>
         int write_deals(const std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
-            ArrayDeals iArrayDeals;
-            iArrayDeals.set_vector(list_deals);
-            return iStorage.write_day_data(iArrayDeals, xtime::get_first_timestamp_day(timestamp));
+            /* данные дня берутся прямо из вектора сделок */
+            ArrayDealsView iArrayDeals(list_deals);
+            if(codec.is_enabled()) {
+                std::string buffer;
+                int err = codec.encode(iArrayDeals.data(), iArrayDeals.size(), buffer);
+                if(err != OK) return err;
+                ArrayDeals iEncodedDeals;
+                iEncodedDeals.assign(buffer.data(), buffer.size());
+                return iStorage.write_day_data(iEncodedDeals, xtime::get_first_timestamp_day(timestamp));
+            }
+            return iStorage.write_day_data(iArrayDeals.get_array(), xtime::get_first_timestamp_day(timestamp));
+        }
+
+        /** \brief Записать сделки за один торговый день
+         * \param list_deals Список сделок
+         * \param timestamp Метка времени
+         * \return Вернет 0 в случае успеха
+         */
+        template<typename T, typename std::enable_if<std::is_same<T, ColumnDealsStorage>::value>::type* = nullptr>
+        int write_deals(const std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
+            ColumnDeals iColumnDeals;
+            if(!iColumnDeals.set_vector(list_deals)) return INVALID_PARAMETER;
+            return iStorage.write_day_data(iColumnDeals, xtime::get_first_timestamp_day(timestamp));
+        }
+
+        /** \brief Записать сделки за один торговый день
+         *
+         * Новые символы сначала записываются в словарь символов хранилища
+         * \param list_deals Список сделок
+         * \param timestamp Метка времени
+         * \return Вернет 0 в случае успеха
+         */
+        template<typename T, typename std::enable_if<std::is_same<T, CompactDealsStorage>::value>::type* = nullptr>
+        int write_deals(const std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
+            CompactArrayDeals iCompactArrayDeals;
+            if(!iCompactArrayDeals.set_vector(list_deals, symbol_dictionary)) return INVALID_PARAMETER;
+            if(symbol_dictionary.modified()) {
+                int err = symbol_dictionary.save(get_symbol_dictionary_path());
+                if(err != OK) return err;
+            }
+            return iStorage.write_day_data(iCompactArrayDeals, xtime::get_first_timestamp_day(timestamp));
+        }
+
+        /** \brief Записать сделки за один торговый день
+         *
+         * Хранилище, отображенное в память, доступно только для чтения
+         * \param list_deals Список сделок
+         * \param timestamp Метка времени
+         * \return Всегда вернет NO_DATA_ACCESS
+         */
+        template<typename T, typename std::enable_if<std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        int write_deals(const std::vector<Deal> &/* list_deals */, const xtime::timestamp_t /* timestamp */) {
+            return NO_DATA_ACCESS;
         }
 
 		/** \brief Прочитать сделки за торговый день
+         * \param storage Хранилище данных, из которого читаются сделки
          * \param list_deals Массив сделок
          * \param timestamp Метка времени
+         * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
          * \return Вернет 0 в случае успеха
          */
         template<typename T, typename std::enable_if<std::is_same<T, xquotes_json_storage::JsonStorage>::value>::type* = nullptr>
-        int read_deals(std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
+        int read_deals(
+                T &storage,
+                std::vector<Deal> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t /* columns */ = ColumnDeals::COLUMN_ALL) {
             list_deals.clear();
             nlohmann::json j;
             try {
-                int err = iStorage.get_json(j, xtime::get_first_timestamp_day(timestamp));
+                int err = storage.get_json(j, xtime::get_first_timestamp_day(timestamp));
                 if(err != xquotes_common::OK) return err;
                 list_deals.resize(j.size());
                 for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -139,71 +591,660 @@ namespace easy_bo {
         }
 
         /** \brief Прочитать сделки за торговый день
+         * \param storage Хранилище данных, из которого читаются сделки
          * \param list_deals Массив сделок
          * \param timestamp Метка времени
+         * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
          * \return Вернет 0 в случае успеха
          */
         template<typename T, typename std::enable_if<std::is_same<T, ArrayDealsStorage>::value>::type* = nullptr>
-        int read_deals(std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
+        int read_deals(
+                T &storage,
+                std::vector<Deal> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t /* columns */ = ColumnDeals::COLUMN_ALL) {
+            list_deals.clear();
+            if(codec.is_enabled()) {
+                ArrayDeals iEncodedDeals;
+                int err = storage.get_day_data(iEncodedDeals, xtime::get_first_timestamp_day(timestamp));
+                if(err != xquotes_common::OK) return err;
+                std::string buffer;
+                err = codec.decode(iEncodedDeals.data(), iEncodedDeals.size(), buffer);
+                if(err != OK) return err;
+                ArrayDealsView iArrayDeals(list_deals);
+                iArrayDeals.assign(buffer.data(), buffer.size());
+                return iArrayDeals.check_broken() ? PARSER_ERROR : OK;
+            }
+            /* данные дня копируются хранилищем прямо в вектор сделок, его емкость используется повторно */
+            ArrayDealsView iArrayDeals(list_deals);
+            int err = storage.get_day_data(iArrayDeals.get_array(), xtime::get_first_timestamp_day(timestamp));
+            if(err != xquotes_common::OK) {
+                list_deals.clear();
+                return err;
+            }
+            return iArrayDeals.check_broken() ? PARSER_ERROR : OK;
+        }
+
+        /** \brief Прочитать сделки за торговый день
+         *
+         * Декодирует только запрошенные колонки, остальные поля сделок останутся по умолчанию.
+         * Метка времени декодируется всегда, т.к. по ней сортируются сделки.
+         * Сам день читается и распаковывается целиком (см. ColumnDeals)
+         * \param storage Хранилище данных, из которого читаются сделки
+         * \param list_deals Массив сделок
+         * \param timestamp Метка времени
+         * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+         * \return Вернет 0 в случае успеха
+         */
+        template<typename T, typename std::enable_if<std::is_same<T, ColumnDealsStorage>::value>::type* = nullptr>
+        int read_deals(
+                T &storage,
+                std::vector<Deal> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t columns = ColumnDeals::COLUMN_ALL) {
             list_deals.clear();
-            ArrayDeals iArrayDeals;
-            int err = iStorage.get_day_data(iArrayDeals, xtime::get_first_timestamp_day(timestamp));
+            ColumnDeals iColumnDeals;
+            int err = storage.get_day_data(iColumnDeals, xtime::get_first_timestamp_day(timestamp));
             if(err != xquotes_common::OK) return err;
-            iArrayDeals.get_vector(list_deals);
+            if(!iColumnDeals.get_vector(list_deals, columns | ColumnDeals::COLUMN_TIMESTAMP)) return PARSER_ERROR;
             return OK;
         }
 
-		/** \brief Сортировка массива сделок
+        /** \brief Прочитать сделки за торговый день
+         * \param storage Хранилище данных, из которого читаются сделки
+         * \param list_deals Массив сделок
+         * \param timestamp Метка времени
+         * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+         * \return Вернет 0 в случае успеха
          */
-        void sort_list_deals(std::vector<Deal> &list_deals) {
-            if(!std::is_sorted(list_deals.begin(), list_deals.end(),
-                [](const Deal &a, const Deal &b) {
-                        return a.timestamp < b.timestamp;
-                    })) {
-                std::sort(list_deals.begin(), list_deals.end(),
-                [](const Deal &a, const Deal &b) {
-                    return a.timestamp < b.timestamp;
-                });
-            }
+        template<typename T, typename std::enable_if<std::is_same<T, CompactDealsStorage>::value>::type* = nullptr>
+        int read_deals(
+                T &storage,
+                std::vector<Deal> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t columns = ColumnDeals::COLUMN_ALL) {
+            list_deals.clear();
+            CompactArrayDeals iCompactArrayDeals;
+            int err = storage.get_day_data(iCompactArrayDeals, xtime::get_first_timestamp_day(timestamp));
+            if(err != xquotes_common::OK) return err;
+            if(!iCompactArrayDeals.get_vector(
+                    list_deals,
+                    symbol_dictionary,
+                    (columns & ColumnDeals::COLUMN_NAME) != 0)) return PARSER_ERROR;
+            return OK;
+        }
+
+        /** \brief Прочитать сделки за торговый день
+         * \param storage Хранилище данных, из которого читаются сделки
+         * \param list_deals Массив сделок
+         * \param timestamp Метка времени
+         * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+         * \return Вернет 0 в случае успеха
+         */
+        template<typename T, typename std::enable_if<std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        int read_deals(
+                T &storage,
+                std::vector<Deal> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t /* columns */ = ColumnDeals::COLUMN_ALL) {
+            list_deals.clear();
+            DealsSpan deals;
+            int err = storage.get_day_span(deals, timestamp);
+            if(err != OK) return err;
+            list_deals.assign(deals.begin(), deals.end());
+            return OK;
         }
 
-		/** \brief Найти сделку по метке времени
-         * \return указатель на сделку с похожей меткой времени
+		/** \brief Сортировка массива сделок
          */
-        typename std::vector<Deal>::iterator find_deal(std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
-            if(list_deals.size() == 0) return list_deals.end();
-            auto list_deals_it = std::lower_bound(
-                list_deals.begin(),
-                list_deals.end(),
-                timestamp,
-                [](const Deal &lhs, const xtime::timestamp_t &timestamp) {
-                return lhs.timestamp < timestamp;
-            });
-            if(list_deals_it == list_deals.end()) {
-                return list_deals.end();
-            } else
-            if(list_deals_it->timestamp == timestamp) {
-                return list_deals_it;
-            }
-            return list_deals.end();
+        void sort_list_deals(std::vector<Deal> &list_deals) {
+            /* порядок сделок с одинаковой меткой времени сохраняется */
+            sort_deals_timestamp(list_deals.data(), list_deals.size());
         }
 
-		bool check_repeat_deal(std::vector<Deal> &list_deals, const Deal &deal) {
-			auto it = find_deal(list_deals, deal.timestamp);
-			if(it == list_deals.end()) return false;
-			const size_t start_offset = it - list_deals.begin();
-			for(size_t i = start_offset; i < list_deals.size(); ++i) {
-				if(list_deals[i] == deal) return true;
-				if(list_deals[i].timestamp > deal.timestamp) break;
+		/** \brief Получить путь к файлу словаря символов
+		 * \return Путь к файлу словаря символов
+		 */
+		inline std::string get_symbol_dictionary_path() const {
+			return store_path + ".symbols";
+		}
+
+		/** \brief Загрузить настройки сжатия хранилища
+		 *
+		 * Собственное сжатие торговых дней поддерживает только бинарное хранилище (FastDealsDataStore)
+		 * \param path Путь к хранилищу
+		 * \return Настройки сжатия
+		 */
+		static DealsCodecConfig load_codec_config(const std::string &path) {
+			DealsCodecConfig config;
+			if(std::is_same<STORAGE_TYPE, ArrayDealsStorage>::value) config.load(path);
+			return config;
+		}
+
+		/** \brief Получить словарь для хранилища дней
+		 *
+		 * При собственном сжатии словарь использует DealsCodec, а хранилище дней получает уже сжатые данные
+		 * \return Словарь zstd или пустая строка
+		 */
+		inline const std::string &get_storage_dictionary() const {
+			static const std::string empty_dictionary;
+			return codec.is_enabled() ? empty_dictionary : storage_dictionary;
+		}
+
+		/** \brief Выбрать торговые дни хранилища для выборки
+		 * \param list_days Метки времени начала дней
+		 * \param max_days Максимальное количество дней, дни выбираются равномерно. 0 - все дни
+		 * \return Вернет код ошибки
+		 */
+		int get_sample_days(std::vector<xtime::timestamp_t> &list_days, const uint32_t max_days) {
+			list_days = get_calendar().get_days();
+			if(list_days.empty()) return NO_DATA_ACCESS;
+			if(max_days > 0 && list_days.size() > max_days) {
+				std::vector<xtime::timestamp_t> sample_days(max_days);
+				for(size_t i = 0; i < sample_days.size(); ++i) {
+					sample_days[i] = list_days[i * list_days.size() / sample_days.size()];
+				}
+				list_days.swap(sample_days);
+			}
+			return OK;
+		}
+
+		/** \brief Загрузить записанные сделки дня буфера записи
+		 *
+		 * Записанные сделки дня читаются один раз: при первой сделке дня или при записи буфера дня.
+		 * По ним и по буферу строится множество отпечатков, повторы удаляются из буфера
+		 * \param write_day Буфер записи дня
+		 */
+		void load_write_day(DealsWriteDay &write_day) {
+			write_day.reset();
+			if(check_timestamp(write_day.timestamp)) {
+				/* в случае отсутствия сделок метод read_deals
+				 * возвращает код ошибки, поэтому его не проверяем
+				 */
+				read_deals<STORAGE_TYPE>(iStorage, write_day.list_stored_deals, write_day.timestamp);
+				sort_list_deals(write_day.list_stored_deals);
+			}
+			write_day.is_loaded = true;
+			if(!is_allow_duplicates) ingest_stats.repeat_deals += write_day.unique();
+		}
+
+		/** \brief Прочитать сделки за торговый день через кэш
+		 *
+		 * Сделки возвращаются отсортированными по времени.
+		 * Прочитанный из хранилища день помещается в кэш декодированных дней
+		 * \param list_deals Массив сделок
+		 * \param timestamp Метка времени
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+		 * \return Вернет 0 в случае успеха
+		 */
+		int read_day_deals(
+				std::vector<Deal> &list_deals,
+				const xtime::timestamp_t timestamp,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
+			const xtime::timestamp_t day_timestamp = xtime::get_first_timestamp_day(timestamp);
+			const uint32_t day_columns = columns | ColumnDeals::COLUMN_TIMESTAMP;
+			if(day_cache.get(list_deals, day_timestamp, day_columns)) return OK;
+			int err = read_deals<STORAGE_TYPE>(iStorage, list_deals, day_timestamp, day_columns);
+			if(err != OK) return err;
+			sort_list_deals(list_deals);
+			day_cache.put(list_deals, day_timestamp, day_columns);
+			return OK;
+		}
+
+		/** \brief Торговать сделками одного дня
+		 *
+		 * Сделки дня просматриваются за один проход, группы сделок
+		 * с одинаковым интервалом передаются обработчику по порядку
+		 * \param list_deals Отсортированные по времени сделки дня
+		 * \param start Метка времени начала дня
+		 * \param callback Обработчик сделок
+		 * \param step Шаг времени внутри дня
+		 * \param flags Режим торговли (см. TRADE_EXACT_TIMESTAMP, TRADE_BUCKETS, TRADE_EMPTY_SLOTS)
+		 */
+		void trade_day(
+				std::vector<Deal> &list_deals,
+				const xtime::timestamp_t start,
+				std::function<void(
+					std::vector<Deal> &deals,
+					const xtime::timestamp_t timestamp)> &callback,
+				const xtime::timestamp_t step,
+				const uint32_t flags) {
+			const bool is_bucket = (flags & TRADE_BUCKETS) != 0;
+			const bool is_empty_slots = (flags & TRADE_EMPTY_SLOTS) != 0;
+			const xtime::timestamp_t stop = start + xtime::SECONDS_IN_DAY;
+			const size_t amount_deals = list_deals.size();
+			std::vector<Deal> temp;
+			size_t index = 0;
+			/* пропускаем сделки до начала дня */
+			while(index < amount_deals && list_deals[index].timestamp < start) ++index;
+			xtime::timestamp_t slot = start;
+			while(slot < stop) {
+				if(!is_empty_slots) {
+					/* переходим сразу к интервалу ближайшей сделки */
+					if(index >= amount_deals || list_deals[index].timestamp >= stop) break;
+					slot = start + ((list_deals[index].timestamp - start) / step) * step;
+				}
+				const xtime::timestamp_t next_slot = slot + step;
+				/* сделки до интервала не попадают в сетку шагов */
+				while(index < amount_deals &&
+					list_deals[index].timestamp < slot) ++index;
+				if(!is_bucket) {
+					/* без режима интервалов в сетку попадают только сделки с меткой времени начала интервала */
+					while(index < amount_deals &&
+						list_deals[index].timestamp < next_slot &&
+						list_deals[index].timestamp != slot) ++index;
+				}
+				const xtime::timestamp_t end_timestamp = is_bucket ? std::min(next_slot, stop) : slot + 1;
+				size_t end_index = index;
+				while(end_index < amount_deals && list_deals[end_index].timestamp < end_timestamp) ++end_index;
+				if(end_index > index || is_empty_slots) {
+					temp.assign(list_deals.begin() + index, list_deals.begin() + end_index);
+					callback(temp, slot);
+				}
+				index = end_index;
+				slot = next_slot;
+			}
+		}
+
+		/** \brief Получить путь к каталогу символов
+		 * \return Путь к файлу каталога
+		 */
+		inline std::string get_symbol_catalog_path() const {
+			return store_path + ".catalog";
+		}
+
+		/** \brief Получить путь к журналу сделок
+		 * \return Путь к файлу журнала
+		 */
+		inline std::string get_journal_path() const {
+			return store_path + ".journal";
+		}
+
+		/** \brief Получить путь к манифесту снимков
+		 * \return Путь к файлу манифеста
+		 */
+		inline std::string get_snapshot_path() const {
+			return store_path + ".snapshot";
+		}
+
+		/** \brief Поместить сделку в буфер записи
+		 *
+		 * Буфер хранит несколько дней (см. set_write_cache_days), поэтому сделки разных дней
+		 * могут идти вперемешку. Каждый день сливается с хранилищем один раз: при вытеснении из буфера или при save.
+		 * Повторы отсекаются сразу, по множеству отпечатков дня (см. set_allow_duplicates)
+		 * \param deal Сделка
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int buffer_deal(const Deal& deal) {
+			const xtime::timestamp_t deal_date_timestamp = xtime::get_first_timestamp_day(deal.timestamp);
+			DealsWriteDay *write_day = write_cache.find(deal_date_timestamp);
+			if(write_day == NULL) {
+				/* при переполнении буфера в хранилище записывается день,
+				 * к которому дольше всего не обращались
+ 				 */
+				while(write_cache.is_full()) {
+					int err = flush_write_day(write_cache.get_oldest());
+					if(err != xquotes_common::OK) return err;
+				}
+				write_day = &write_cache.insert(deal_date_timestamp);
+			}
+			++ingest_stats.deals;
+			if(!is_allow_duplicates) {
+				if(!write_day->is_loaded) load_write_day(*write_day);
+				if(!write_day->insert(deal, write_day->list_stored_deals.size() + write_day->list_deals.size())) {
+					++ingest_stats.repeat_deals;
+					return OK;
+				}
+			}
+			write_day->add_deal(deal);
+			return OK;
+		}
+
+		/** \brief Проверить, изменен ли день после сохранения хранилища
+		 * \param timestamp Метка времени начала дня
+		 * \return Вернет true, если день записан, но не сохранен, или находится в буфере записи
+		 */
+		inline bool check_unsaved_day(const xtime::timestamp_t timestamp) const {
+			return unsaved_days.count(timestamp) > 0 || write_cache.check(timestamp);
+		}
+
+		/** \brief Остановить рабочие потоки упреждающего чтения перед записью в хранилище
+		 */
+		void stop_readers() {
+			for(auto it = list_readers.begin(); it != list_readers.end(); ++it) {
+				(*it)->stop_workers();
+			}
+		}
+
+		/** \brief Сохранить хранилище, итоги дней и каталог символов
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int save_storage() {
+			stop_readers();
+			iStorage.save();
+			unsaved_days.clear();
+			if(iSummaryStorage) iSummaryStorage->save();
+			if(symbol_catalog.modified() && !std::is_same<STORAGE_TYPE, MappedDealsStorage>::value) {
+				return symbol_catalog.save(get_symbol_catalog_path());
+			}
+			return OK;
+		}
+
+		/** \brief Обновить каталог символов после перезаписи дня
+		 * \param old_deals Сделки дня до записи
+		 * \param new_deals Сделки дня после записи
+		 * \param timestamp Метка времени дня
+		 */
+		void update_symbol_catalog(
+				const std::vector<Deal> &old_deals,
+				const std::vector<Deal> &new_deals,
+				const xtime::timestamp_t timestamp) {
+			if(!is_symbol_catalog) return;
+			symbol_catalog.remove_day(old_deals);
+			symbol_catalog.add_day(new_deals, timestamp);
+		}
+
+		/** \brief Подготовить каталог символов
+		 *
+		 * Если каталога нет (например, хранилище записано старой версией), он строится по всем дням
+		 * \return Вернет true, если каталог актуален
+		 */
+		bool prepare_symbol_catalog() {
+			if(is_symbol_catalog) return true;
+			return rebuild_symbol_catalog() == OK;
+		}
+
+		/** \brief Получить путь к хранилищу итогов торговых дней
+		 * \return Путь к файлу итогов
+		 */
+		inline std::string get_summary_path() const {
+			return store_path + ".sum";
+		}
+
+		/** \brief Записать итоги торгового дня
+		 * \param list_deals Список сделок дня
+		 * \param timestamp Метка времени
+		 * \return Вернет 0 в случае успеха
+		 */
+		int write_summary(const std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
+			if(!iSummaryStorage) return OK;
+			DaySummary day_summary;
+			day_summary.set_vector(list_deals);
+			return iSummaryStorage->write_day_data(day_summary, xtime::get_first_timestamp_day(timestamp));
+		}
+
+		/** \brief Посчитать сделки за указанное количество дней по итогам дней
+		 *
+		 * Повторяет отбор дней метода get_deals_days без декодирования сделок.
+		 * Если у какого-либо дня нет итогов или его сделки выходят за последнюю дату,
+		 * метод вернет false, и расчет нужно выполнить по сделкам
+		 * \param err Код ошибки
+		 * \param wins Количество удачных сделок
+		 * \param losses Количество остальных сделок
+		 * \param days Количество дней
+		 * \param stop_timestamp Конечная дата
+		 * \param start_minute_day Начальная минута дня (включительно)
+		 * \param stop_minute_day Конечная минута дня (не включительно)
+		 * \param symbol_index Индекс символа или -1, если фильтр не нужен
+		 * \param symbol_name Буфер имени символа или nullptr, если фильтр не нужен
+		 * \return Вернет true, если результат получен по итогам дней
+		 */
+		bool get_summary_deals(
+				int &err,
+				uint32_t &wins,
+				uint32_t &losses,
+				const uint32_t days,
+				const xtime::timestamp_t stop_timestamp,
+				const uint32_t start_minute_day = 0,
+				const uint32_t stop_minute_day = xtime::MINUTES_IN_DAY,
+				const int32_t symbol_index = -1,
+				const int8_t *symbol_name = nullptr) {
+			if(!iSummaryStorage) return false;
+			wins = 0;
+			losses = 0;
+			xtime::timestamp_t min_timestamp = 0;
+			xtime::timestamp_t max_timestamp = 0;
+			err = get_min_max_timestamp(min_timestamp, max_timestamp);
+			if(err != xquotes_common::OK) return true;
+			const xtime::timestamp_t protection_timestamp = xtime::get_last_timestamp_day(
+				xtime::get_first_timestamp_day(stop_timestamp) - xtime::SECONDS_IN_DAY);
+			const DealsCalendar &days_calendar = get_calendar();
+			DealsCalendar::const_iterator it = days_calendar.lower_bound(stop_timestamp);
+			uint32_t day = 0;
+			while(day < days && it != days_calendar.begin()) {
+				const xtime::timestamp_t timestamp = *(--it);
+				DaySummary day_summary;
+				if(iSummaryStorage->get_day_data(day_summary, timestamp) != xquotes_common::OK ||
+					!day_summary.is_valid()) return false;
+				if(day_summary.get_max_end_timestamp() > protection_timestamp) return false;
+				uint32_t day_wins = 0, day_losses = 0;
+				day_summary.count_deals(
+					day_wins,
+					day_losses,
+					start_minute_day,
+					stop_minute_day,
+					symbol_index,
+					symbol_name);
+				/* пропускаем этот день без сделок */
+				if((day_wins + day_losses) == 0) continue;
+				wins += day_wins;
+				losses += day_losses;
+				++day;
+			}
+			if(day < days || (wins + losses) == 0) err = NO_DATA_ACCESS;
+			return true;
+		}
+
+		/** \brief Получить винрейт по итогам дней
+		 *
+		 * Аналог расчета винрейта через get_deals_days без пользовательского фильтра
+		 * \return Вернет true, если результат получен по итогам дней
+		 */
+		template<class T>
+		bool get_summary_winrate(
+				int &err,
+				T &winrate,
+				const uint32_t days,
+				const xtime::timestamp_t stop_timestamp,
+				const uint32_t start_minute_day = 0,
+				const uint32_t stop_minute_day = xtime::MINUTES_IN_DAY,
+				const int32_t symbol_index = -1,
+				const int8_t *symbol_name = nullptr) {
+			uint32_t wins = 0, losses = 0;
+			if(!get_summary_deals(
+				err,
+				wins,
+				losses,
+				days,
+				stop_timestamp,
+				start_minute_day,
+				stop_minute_day,
+				symbol_index,
+				symbol_name)) return false;
+			if(err == OK) winrate = (T)wins / (T)(wins + losses);
+			return true;
+		}
+
+		/** \brief Записать в хранилище буфер сделок дня
+		 *
+		 * Сортировка буфера выполняется один раз, здесь, а не при добавлении каждой сделки.
+		 * Если за день уже есть данные, они объединяются с буфером.
+		 * Записанный день удаляется из буфера записи
+		 * \param write_day Буфер записи дня
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int flush_write_day(DealsWriteDay &write_day) {
+			const xtime::timestamp_t timestamp = write_day.timestamp;
+			/* буфер, заполненный в обход buffer_deal, проверяется на повторы здесь */
+			if(write_day.list_deals.size() > 0 && !write_day.is_loaded) load_write_day(write_day);
+			if(write_day.list_deals.size() == 0) {
+				write_cache.erase(timestamp);
+				return OK;
+			}
+			std::vector<Deal> temp;
+			temp.swap(write_day.list_stored_deals);
+			write_day.reset();
+			if(!write_day.is_sorted) {
+				std::stable_sort(write_day.list_deals.begin(), write_day.list_deals.end(),
+					[](const Deal &a, const Deal &b) {
+						return a.timestamp < b.timestamp;
+					});
+				write_day.is_sorted = true;
+			}
+
+			stop_readers();
+			unsaved_days.insert(timestamp);
+			int err = OK;
+			if(temp.size() > 0) {
+				/* объединим старые сделки с буфером, старые сделки с той же меткой времени идут первыми */
+				std::vector<Deal> list_deals(temp.size() + write_day.list_deals.size());
+				std::merge(
+					temp.begin(), temp.end(),
+					write_day.list_deals.begin(), write_day.list_deals.end(),
+					list_deals.begin(),
+					[](const Deal &a, const Deal &b) {
+						return a.timestamp < b.timestamp;
+					});
+				err = write_deals<STORAGE_TYPE>(list_deals, timestamp);
+				if(err == xquotes_common::OK) err = write_summary(list_deals, timestamp);
+				if(err == xquotes_common::OK) update_symbol_catalog(temp, list_deals, timestamp);
+			} else {
+				err = write_deals<STORAGE_TYPE>(write_day.list_deals, timestamp);
+				if(err == xquotes_common::OK) err = write_summary(write_day.list_deals, timestamp);
+				if(err == xquotes_common::OK) update_symbol_catalog(temp, write_day.list_deals, timestamp);
+			}
+			day_cache.invalidate(timestamp);
+			if(err != xquotes_common::OK) return err;
+			calendar.add_day(timestamp);
+			snapshot_days.insert(timestamp);
+			write_cache.erase(timestamp);
+			++ingest_stats.days;
+			return OK;
+		}
+
+		/** \brief Записать в хранилище все дни буфера записи
+		 *
+		 * Дни записываются по возрастанию времени
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int flush_write_deals() {
+			while(!write_cache.empty()) {
+				int err = flush_write_day(write_cache.get_first());
+				if(err != xquotes_common::OK) return err;
+			}
+			return OK;
+		}
+
+		/** \brief Записать в хранилище сделки одного дня в обход буфера записи
+		 *
+		 * Сделки сливаются с уже записанными сделками дня, как при записи через add_deals
+		 * \param list_deals Отсортированный по времени массив сделок, после вызова содержимое не определено
+		 * \param timestamp Метка времени начала дня
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int write_day_deals(std::vector<Deal> &list_deals, const xtime::timestamp_t timestamp) {
+			/* день может быть в буфере записи, тогда его новые сделки записываются первыми */
+			if(write_cache.find(timestamp) != NULL) {
+				int err = flush_write_day(*write_cache.find(timestamp));
+				if(err != xquotes_common::OK) return err;
+			}
+			DealsWriteDay &write_day = write_cache.insert(timestamp);
+			write_day.list_deals.swap(list_deals);
+			int err = flush_write_day(write_day);
+			/* при ошибке день не остается в буфере записи */
+			if(err != xquotes_common::OK) write_cache.erase(timestamp);
+			return err;
+		}
+
+		/** \brief Замерить время чтения всех дней хранилища
+		 * \return Время в секундах
+		 */
+		double get_scan_seconds() {
+			const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+			const DealsCalendar &days_calendar = get_calendar();
+			std::vector<Deal> list_deals;
+			for(DealsCalendar::const_iterator it = days_calendar.begin(); it != days_calendar.end(); ++it) {
+				read_deals<STORAGE_TYPE>(iStorage, list_deals, *it);
 			}
-			return false;
+			return std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start_time).count();
+		}
+
+		/** \brief Получить набор колонок для расчета винрейта
+		 *
+		 * Пользовательскому фильтру могут понадобиться все поля сделки,
+		 * без него достаточно результата сделки
+		 * \param callback Функция для обратного вызова
+		 * \return Набор колонок (см. ColumnDeals)
+		 */
+		static uint32_t get_winrate_columns(const std::function<void(std::vector<Deal> &deals)> &callback) {
+			return callback == nullptr ? ColumnDeals::COLUMN_RESULT : ColumnDeals::COLUMN_ALL;
+		}
+
+		/** \brief Проверить наличие файла
+		 * \param path Путь к файлу
+		 * \return Вернет true, если файл можно открыть
+		 */
+		static bool check_file(const std::string &path) {
+			std::ifstream file(path, std::ios::binary);
+			return (bool)file;
+		}
+
+		/** \brief Переименовать файл с заменой существующего
+		 * \param from Путь к файлу
+		 * \param to Новый путь к файлу, существующий файл заменяется атомарно
+		 * \return Вернет true в случае успеха
+		 */
+		static bool replace_file(const std::string &from, const std::string &to) {
+#           if defined(_WIN32)
+			return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#           else
+			return std::rename(from.c_str(), to.c_str()) == 0;
+#           endif
 		}
 
 	public:
 		/** \brief Инициализировать базу данных новостей
          * \param _path путь к базе данных
          */
-        DealsDataStoreTemplate(const std::string &path) : iStorage(path) {};
+        DealsDataStoreTemplate(const std::string &path) :
+                storage_dictionary(DealsStorageDictionary::load(path)),
+                codec(load_codec_config(path), storage_dictionary),
+                iStorage(path, get_storage_dictionary()),
+                store_path(path) {
+            symbol_dictionary.load(get_symbol_dictionary_path());
+            /* хранилище, отображенное в память, только читает данные и итогов не имеет */
+            if(!std::is_same<STORAGE_TYPE, MappedDealsStorage>::value) {
+                iSummaryStorage = std::unique_ptr<DaySummaryStorage>(new DaySummaryStorage(get_summary_path()));
+            }
+            /* у нового хранилища каталог пуст, у существующего без каталога он будет построен при первом запросе */
+            xtime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+            is_symbol_catalog =
+                symbol_catalog.load(get_symbol_catalog_path()) == OK ||
+                get_min_max_timestamp(min_timestamp, max_timestamp) != OK;
+            /* сделки из журнала не были сохранены в хранилище, повторяем их добавление.
+             * Уже записанные в хранилище сделки будут пропущены как повторы.
+             * Журнал прошлого сеанса применяется, даже если в этом сеансе журнал не включен
+             */
+            if(!std::is_same<STORAGE_TYPE, MappedDealsStorage>::value) {
+                journal.set_path(get_journal_path());
+                std::vector<Deal> journal_deals;
+                if(journal.load(journal_deals) == OK) {
+                    for(size_t i = 0; i < journal_deals.size(); ++i) {
+                        buffer_deal(journal_deals[i]);
+                    }
+                }
+            }
+        };
+
+        /** \brief Получить словарь символов хранилища
+         *
+         * Словарь заполняется только хранилищем компактных сделок (CompactDealsDataStore)
+         * \return Словарь символов
+         */
+        inline const SymbolDictionary &get_symbol_dictionary() const {
+            return symbol_dictionary;
+        }
 
 		/** \brief Проверить наличие новостей за торговый день по метке времени
          * \param timestamp метка времени
@@ -213,6 +1254,26 @@ namespace easy_bo {
             return iStorage.check_timestamp(timestamp);
         }
 
+        /** \brief Получить календарь дней хранилища
+         *
+         * При первом вызове календарь строится проверкой всех дней между первым и последним днем хранилища,
+         * затем пополняется при записи сделок. Дни в буфере записи появятся в календаре после его сброса
+         * \return Календарь дней хранилища
+         */
+        const DealsCalendar &get_calendar() {
+            if(!calendar.built()) {
+                std::vector<xtime::timestamp_t> days;
+                xtime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+                if(get_min_max_timestamp(min_timestamp, max_timestamp) == OK) {
+                    for(xtime::timestamp_t t = min_timestamp; t <= max_timestamp; t += xtime::SECONDS_IN_DAY) {
+                        if(check_timestamp(t)) days.push_back(t);
+                    }
+                }
+                calendar.set_days(days);
+            }
+            return calendar;
+        }
+
         /** \brief Узнать максимальную и минимальную метку времени подфайлов
          * \param min_timestamp Метка времени в начале дня начала исторических данных
          * \param max_timestamp Метка времени в начале дня конца исторических данных
@@ -237,76 +1298,532 @@ namespace easy_bo {
             iStorage.set_indent(indent_timestamp_past, indent_timestamp_future);
         }
 
-        /** \brief Сохранить данные
+        /** \brief Сохранить данные
+         *
+         * Метод  принудительно сохраняет все данные, которые еще не записаны в файл а находятся только в буфере.
+         */
+        int save() {
+			int err = flush_write_deals();
+            int err_storage = save_storage();
+            if(err == OK) err = err_storage;
+            /* журнал очищается только после успешного сохранения */
+            if(err == OK && journal.size() > 0) {
+                std::vector<Deal> list_deals;
+                write_cache.get_deals(list_deals);
+                err = journal.reset(list_deals);
+            }
+            return err;
+        }
+
+        /** \brief Получить сделки за указанный торговый день
+         *
+         * \param list_deals Массив сделок
+         * \param timestamp Дата
+         * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+         * \return Вернет код ошибки
+         */
+        int get_deals(
+                std::vector<Deal> &list_deals,
+                const xtime::timestamp_t timestamp,
+                std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+            if(!check_timestamp(timestamp)) return easy_bo::NO_DATA_ACCESS;
+            int err = read_day_deals(list_deals, timestamp);
+            if(err != easy_bo::OK) return err;
+            sort_list_deals(list_deals);
+            if(callback != nullptr) callback(list_deals);
+            if(list_deals.size() == 0) return easy_bo::NO_DATA_ACCESS;
+            return easy_bo::OK;
+        }
+
+        /** \brief Получить сделки за указанный торговый день без копирования
+         *
+         * Метод доступен только для хранилища, отображенного в память (MappedDealsDataStore).
+         * Сделки уже отсортированы по времени, массив действителен, пока открыто хранилище
+         * \param deals Массив сделок
+         * \param timestamp Дата
+         * \return Вернет код ошибки
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        int get_deals_view(DealsSpan &deals, const xtime::timestamp_t timestamp) {
+            int err = iStorage.get_day_span(deals, timestamp);
+            if(err != OK) return err;
+            if(deals.size() == 0) return easy_bo::NO_DATA_ACCESS;
+            return easy_bo::OK;
+        }
+
+        /** \brief Получить курсор сделок
+         *
+         * Курсор читает сделки по одному дню, поэтому подходит для обработки длинной истории
+         * без загрузки всех сделок в память. Курсор действителен, пока существует хранилище
+         * \param start_timestamp Начальная метка времени
+         * \param stop_timestamp Конечная метка времени, сделки, закончившиеся позже, пропускаются
+         * \param direction Направление движения курсора (DealsCursor::FORWARD или DealsCursor::BACKWARD)
+         * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок дня
+         * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+         * \param query Условия отбора сделок (см. DealsQuery)
+         * \return Курсор сделок
+         */
+        DealsCursor get_cursor(
+                const xtime::timestamp_t start_timestamp,
+                const xtime::timestamp_t stop_timestamp,
+                const int direction = DealsCursor::FORWARD,
+                std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+                const uint32_t columns = ColumnDeals::COLUMN_ALL,
+                const DealsQuery &query = DealsQuery()) {
+            return DealsCursor(this, start_timestamp, stop_timestamp, direction, callback, columns, query);
+        }
+
+        /** \brief Записать хранилище в файл для отображения в память
+         *
+         * Полученный файл можно открыть в режиме только для чтения через MappedDealsDataStore.
+         * Несколько процессов, открывших такой файл, разделяют его страницы через кэш ОС
+         * \param path Путь к файлу
+         * \return Вернет код ошибки
+         */
+        int write_mapped_file(const std::string &path) {
+            int err = save();
+            if(err != OK) return err;
+            MappedDealsWriter writer;
+            err = writer.open(path);
+            if(err != OK) return err;
+            const DealsCalendar &days_calendar = get_calendar();
+            std::vector<Deal> list_deals;
+            for(DealsCalendar::const_iterator it = days_calendar.begin(); it != days_calendar.end(); ++it) {
+                if(read_deals<STORAGE_TYPE>(iStorage, list_deals, *it) != OK) continue;
+                sort_list_deals(list_deals);
+                err = writer.add_day(*it, list_deals);
+                if(err != OK) return err;
+            }
+            return writer.close();
+        }
+
+        /** \brief Перенести сделки из другого хранилища
+         *
+         * Дни исходного хранилища читаются по порядку, при threads > 0 следующие дни
+         * декодируются в рабочих потоках (см. set_prefetch), пока записывается текущий.
+         * Каждый день записывается целиком, минуя журнал, и сливается с уже записанными сделками,
+         * как при записи через add_deals. После записи день читается обратно и сравнивается
+         * по контрольной сумме (см. get_deals_checksum)
+         * \param source Исходное хранилище сделок любого типа
+         * \param stats Статистика и отчет по дням
+         * \param threads Количество потоков чтения исходного хранилища
+         * \param is_verify Проверять записанные дни
+         * \return Вернет код ошибки
+         */
+        template<class SOURCE_STORE>
+        int convert_from(
+                SOURCE_STORE &source,
+                DealsConvertStats &stats,
+                const uint32_t threads = 0,
+                const bool is_verify = true) {
+            const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+            stats = DealsConvertStats();
+            int err = flush_write_deals();
+            if(err != OK) return err;
+            xtime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+            err = source.get_min_max_timestamp(min_timestamp, max_timestamp);
+            if(err != OK) return err;
+            const uint32_t source_threads = source.get_prefetch_threads();
+            const uint32_t source_depth = source.get_prefetch_depth();
+            source.set_prefetch(threads);
+            {
+                auto cursor = source.get_cursor(
+                    min_timestamp,
+                    std::numeric_limits<xtime::timestamp_t>::max());
+                std::vector<Deal> list_deals;
+                std::vector<Deal> temp;
+                xtime::timestamp_t timestamp = 0;
+                while(cursor.next_day(list_deals, timestamp)) {
+                    DealsConvertDay report;
+                    report.timestamp = xtime::get_first_timestamp_day(timestamp);
+                    report.amount_deals = list_deals.size();
+                    report.source_checksum = get_deals_checksum(list_deals);
+                    ingest_stats.deals += list_deals.size();
+                    /* курсор отдает отсортированные дни */
+                    report.err = write_day_deals(list_deals, report.timestamp);
+                    if(report.err == OK && is_verify) {
+                        report.err = read_deals<STORAGE_TYPE>(iStorage, temp, report.timestamp);
+                        sort_list_deals(temp);
+                        report.target_checksum = get_deals_checksum(temp);
+                    } else
+                    if(report.err == OK) {
+                        report.target_checksum = report.source_checksum;
+                    }
+                    if(!report.is_verified()) ++stats.failed_days;
+                    ++stats.days;
+                    stats.deals += report.amount_deals;
+                    stats.list_days.push_back(report);
+                }
+            }
+            source.set_prefetch(source_threads, source_depth);
+            err = save();
+            stats.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_time).count();
+            if(err != OK) return err;
+            return stats.failed_days == 0 ? OK : UNKNOWN_ERROR;
+        }
+
+        /** \brief Обучить словарь zstd на торговых днях хранилища
+         *
+         * Образцами служат несжатые данные дней, выбранных равномерно по всему хранилищу.
+         * Словарь можно записать для нового хранилища (см. save_dictionary) и перенести
+         * в него сделки методом convert_from
+         * \param dictionary Словарь
+         * \param capacity Максимальный размер словаря
+         * \param max_days Максимальное количество дней в выборке, 0 - все дни
+         * \return Вернет код ошибки
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<is_daily_data_storage<T>::value>::type* = nullptr>
+        int train_dictionary(
+                std::string &dictionary,
+                const size_t capacity = DealsStorageDictionary::DEFAULT_SIZE,
+                const uint32_t max_days = 0) {
+            dictionary.clear();
+            std::vector<xtime::timestamp_t> list_days;
+            int err = get_sample_days(list_days, max_days);
+            if(err != OK) return err;
+            std::string samples;
+            std::vector<size_t> samples_sizes;
+            typename is_daily_data_storage<T>::payload_type payload;
+            std::string buffer;
+            for(size_t i = 0; i < list_days.size(); ++i) {
+                if(iStorage.get_day_data(payload, list_days[i]) != xquotes_common::OK) continue;
+                /* образцы должны быть несжатыми */
+                if(codec.decode(payload.data(), payload.size(), buffer) != OK) continue;
+                if(buffer.size() == 0) continue;
+                samples.append(buffer);
+                samples_sizes.push_back(buffer.size());
+            }
+            return DealsStorageDictionary::train(dictionary, samples, samples_sizes, capacity);
+        }
+
+        /** \brief Записать словарь zstd для нового хранилища
+         *
+         * Словарь записывается в файл <путь>.dict и загружается при каждом открытии хранилища.
+         * Дни уже существующего хранилища сжаты без словаря, поэтому для него словарь не записывается
+         * \param path Путь к новому хранилищу
+         * \param dictionary Словарь
+         * \return Вернет код ошибки, INVALID_PARAMETER если хранилище уже существует
+         */
+        static int save_dictionary(const std::string &path, const std::string &dictionary) {
+            return DealsStorageDictionary::save(path, dictionary);
+        }
+
+        /** \brief Получить идентификатор словаря zstd хранилища
+         * \return Идентификатор словаря или 0, если хранилище открыто без словаря
+         */
+        inline uint32_t get_dictionary_id() const {
+            return DealsStorageDictionary::get_id(storage_dictionary);
+        }
+
+        /** \brief Записать настройки сжатия для нового хранилища
+         *
+         * Настройки записываются в файл <путь>.codec и загружаются при каждом открытии хранилища.
+         * Сделки существующего хранилища переносятся в новое методом convert_from
+         * \param path Путь к новому хранилищу
+         * \param config Настройки сжатия
+         * \return Вернет код ошибки, INVALID_PARAMETER если хранилище уже существует
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<std::is_same<T, ArrayDealsStorage>::value>::type* = nullptr>
+        static int save_codec_config(const std::string &path, const DealsCodecConfig &config) {
+            return config.save(path);
+        }
+
+        /** \brief Получить настройки сжатия хранилища
+         * \return Настройки сжатия
+         */
+        inline const DealsCodecConfig &get_codec_config() const {
+            return codec.get_config();
+        }
+
+        /** \brief Замерить сжатие торговых дней хранилища
+         *
+         * Дни выборки сжимаются и распаковываются с указанными настройками и словарем хранилища,
+         * распакованные данные сравниваются с исходными. Скорость считается по размеру несжатых данных
+         * \param config Настройки сжатия
+         * \param result Результат замера
+         * \param max_days Максимальное количество дней в выборке, 0 - все дни
+         * \return Вернет код ошибки
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<std::is_same<T, ArrayDealsStorage>::value>::type* = nullptr>
+        int benchmark_codec(
+                const DealsCodecConfig &config,
+                DealsCodecBenchmark &result,
+                const uint32_t max_days = 0) {
+            result = DealsCodecBenchmark();
+            result.config = config;
+            DealsCodec test_codec;
+            result.err = test_codec.init(config, storage_dictionary);
+            if(result.err != OK) return result.err;
+            std::vector<xtime::timestamp_t> list_days;
+            result.err = get_sample_days(list_days, max_days);
+            if(result.err != OK) return result.err;
+
+            std::vector<std::string> list_raw;
+            std::vector<Deal> list_deals;
+            for(size_t i = 0; i < list_days.size(); ++i) {
+                if(read_deals<STORAGE_TYPE>(iStorage, list_deals, list_days[i]) != OK) continue;
+                const ArrayDealsView iArrayDeals(static_cast<const std::vector<Deal>&>(list_deals));
+                list_raw.push_back(std::string(iArrayDeals.data(), iArrayDeals.size()));
+                result.raw_bytes += iArrayDeals.size();
+            }
+            result.days = list_raw.size();
+            if(result.raw_bytes == 0) {
+                result.err = NO_DATA_ACCESS;
+                return result.err;
+            }
+
+            std::vector<std::string> list_encoded(list_raw.size());
+            std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < list_raw.size() && result.err == OK; ++i) {
+                result.err = test_codec.encode(list_raw[i].data(), list_raw[i].size(), list_encoded[i]);
+                result.encoded_bytes += list_encoded[i].size();
+            }
+            const double encode_seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_time).count();
+
+            std::string buffer;
+            DealsDecodeContext decode_context;
+            start_time = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < list_encoded.size() && result.err == OK; ++i) {
+                result.err = test_codec.decode(list_encoded[i].data(), list_encoded[i].size(), buffer, decode_context);
+                if(result.err == OK && buffer != list_raw[i]) result.err = PARSER_ERROR;
+            }
+            const double decode_seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_time).count();
+            if(result.err != OK) return result.err;
+
+            const double raw_megabytes = (double)result.raw_bytes / (1024.0 * 1024.0);
+            if(result.encoded_bytes > 0) result.ratio = (double)result.raw_bytes / (double)result.encoded_bytes;
+            if(encode_seconds > 0) result.encode_speed = raw_megabytes / encode_seconds;
+            if(decode_seconds > 0) result.decode_speed = raw_megabytes / decode_seconds;
+            return OK;
+        }
+
+        /** \brief Сжать хранилище
+         *
+         * Живые дни переписываются подряд по возрастанию времени в новое хранилище <путь>.compact
+         * с тем же словарем и настройками сжатия, после чего его файлы заменяют файлы хранилища.
+         * Дни и сделки, которые не проходят правила хранения, не переносятся, пустые дни удаляются.
+         * Сжатие выполняется без открытого хранилища: оно не должно быть открыто ни в одном процессе.
+         * Старые файлы удаляются только после того, как все файлы нового хранилища встали на место,
+         * при ошибке замены хранилище остается прежним.
+         * Если какой-либо день не читается, сжатие прерывается до замены файлов.
+         * Опубликованные снимки (см. publish_snapshot) не изменяются
+         * \param path Путь к хранилищу
+         * \param policy Правила хранения
+         * \param stats Статистика сжатия
+         * \return Вернет код ошибки
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<!std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        static int compact(
+                const std::string &path,
+                const DealsRetentionPolicy &policy,
+                DealsCompactStats &stats) {
+            const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+            stats = DealsCompactStats();
+            const std::string temp_path = path + ".compact";
+            const char *list_suffix[] = {"", ".sum", ".catalog", ".symbols", ".dict", ".codec", ".journal"};
+            const size_t amount_suffix = sizeof(list_suffix) / sizeof(list_suffix[0]);
+            for(size_t i = 0; i < amount_suffix; ++i) {
+                std::remove((temp_path + list_suffix[i]).c_str());
+            }
+            {
+                DealsDataStoreTemplate source(path);
+                /* сделки из журнала попадут в хранилище до сжатия */
+                int err = source.save();
+                if(err != OK) return err;
+                stats.bytes_before = DealsCompactStats::get_file_size(path);
+                stats.scan_seconds_before = source.get_scan_seconds();
+                if(!source.storage_dictionary.empty()) {
+                    err = DealsStorageDictionary::save(temp_path, source.storage_dictionary);
+                    if(err != OK) return err;
+                }
+                if(source.codec.is_enabled()) {
+                    err = source.codec.get_config().save(temp_path);
+                    if(err != OK) return err;
+                }
+                DealsDataStoreTemplate target(temp_path);
+                const DealsCalendar &days_calendar = source.get_calendar();
+                const xtime::timestamp_t first_day = days_calendar.empty() ?
+                    0 : policy.get_first_day(*(days_calendar.end() - 1));
+                stats.days_before = days_calendar.size();
+                std::vector<Deal> list_deals;
+                for(DealsCalendar::const_iterator it = days_calendar.begin(); it != days_calendar.end(); ++it) {
+                    /* пустой день читается без ошибки, ошибка значит, что день поврежден,
+                     * и без него хранилище заменять нельзя
+                     */
+                    err = source.template read_deals<STORAGE_TYPE>(source.iStorage, list_deals, *it);
+                    if(err != OK) return err;
+                    stats.deals_before += list_deals.size();
+                    if(*it < first_day) continue;
+                    policy.apply(list_deals);
+                    if(list_deals.empty()) continue;
+                    ++stats.days_after;
+                    stats.deals_after += list_deals.size();
+                    /* дни идут по возрастанию */
+                    source.sort_list_deals(list_deals);
+                    err = target.write_day_deals(list_deals, *it);
+                    if(err != OK) return err;
+                }
+                err = target.save();
+                if(err != OK) return err;
+            }
+            /* старые файлы сохраняются как <файл>.bak, пока все файлы нового хранилища не встанут на место,
+             * при ошибке старые файлы возвращаются
+             */
+            bool is_old_file[amount_suffix] = {};
+            bool is_new_file[amount_suffix] = {};
+            size_t amount_old = 0, amount_new = 0;
+            int err = OK;
+            for(; amount_old < amount_suffix && err == OK; ++amount_old) {
+                const std::string old_file = path + list_suffix[amount_old];
+                is_old_file[amount_old] = check_file(old_file);
+                if(is_old_file[amount_old] && !replace_file(old_file, old_file + ".bak")) {
+                    is_old_file[amount_old] = false;
+                    err = NO_DATA_ACCESS;
+                }
+            }
+            /* файл хранилища заменяется последним */
+            for(; err == OK && amount_new < amount_suffix; ++amount_new) {
+                const size_t i = amount_suffix - 1 - amount_new;
+                const std::string new_file = temp_path + list_suffix[i];
+                is_new_file[i] = check_file(new_file);
+                if(is_new_file[i] && !replace_file(new_file, path + list_suffix[i])) {
+                    is_new_file[i] = false;
+                    err = NO_DATA_ACCESS;
+                }
+            }
+            for(size_t i = 0; i < amount_suffix; ++i) {
+                const std::string old_file = path + list_suffix[i];
+                if(err != OK) {
+                    if(is_new_file[i]) replace_file(old_file, temp_path + list_suffix[i]);
+                    if(is_old_file[i]) replace_file(old_file + ".bak", old_file);
+                } else
+                if(is_old_file[i]) {
+                    std::remove((old_file + ".bak").c_str());
+                }
+            }
+            if(err != OK) return err;
+            stats.bytes_after = DealsCompactStats::get_file_size(path);
+            {
+                DealsDataStoreTemplate compacted(path);
+                stats.scan_seconds_after = compacted.get_scan_seconds();
+            }
+            stats.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_time).count();
+            return OK;
+        }
+
+        /** \brief Опубликовать снимок хранилища для читателей
+         *
+         * Дни, измененные после прошлой публикации, записываются в новый сегмент,
+         * после чего манифест <путь>.snapshot атомарно заменяется. Читатели открывают манифест
+         * через MappedDealsDataStore и видят одну версию данных до вызова refresh_snapshot.
+         * Первый снимок содержит все дни хранилища. Изменения, сделанные в другом сеансе
+         * работы с хранилищем, попадут в снимок только при полной публикации
+         * \param is_full Записать в новый сегмент все дни хранилища
+         * \return Вернет код ошибки
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<!std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        int publish_snapshot(const bool is_full = false) {
+            int err = save();
+            if(err != OK) return err;
+            const std::string path = get_snapshot_path();
+            MappedDealsManifest manifest;
+            std::set<xtime::timestamp_t> days;
+            if(manifest.load(path) != OK || is_full) {
+                const uint64_t generation = manifest.generation;
+                manifest = MappedDealsManifest();
+                manifest.generation = generation;
+                const DealsCalendar &days_calendar = get_calendar();
+                days.insert(days_calendar.begin(), days_calendar.end());
+            } else {
+                days = snapshot_days;
+            }
+            if(days.empty() && manifest.generation > 0) {
+                snapshot_days.clear();
+                return OK;
+            }
+
+            /* новый сегмент содержит только измененные дни, пустые дни исключаются из снимка */
+            const uint64_t segment = manifest.generation + 1;
+            std::map<uint64_t, uint64_t> list_days;
+            for(size_t i = 0; i < manifest.days.size(); ++i) {
+                list_days[manifest.days[i].timestamp] = manifest.days[i].segment;
+            }
+            MappedDealsWriter writer;
+            err = writer.open(MappedDealsManifest::get_segment_path(path, segment));
+            if(err != OK) return err;
+            std::vector<Deal> list_deals;
+            for(auto it = days.begin(); it != days.end(); ++it) {
+                const uint64_t day = xtime::get_first_timestamp_day(*it);
+                list_deals.clear();
+                if(check_timestamp(day)) read_deals<STORAGE_TYPE>(iStorage, list_deals, day);
+                if(list_deals.size() == 0) {
+                    list_days.erase(day);
+                    continue;
+                }
+                sort_list_deals(list_deals);
+                err = writer.add_day(day, list_deals);
+                if(err != OK) return err;
+                list_days[day] = segment;
+            }
+            err = writer.close();
+            if(err != OK) return err;
+
+            const std::vector<uint64_t> old_segments = manifest.segments;
+            std::set<uint64_t> segments;
+            manifest.days.clear();
+            for(auto it = list_days.begin(); it != list_days.end(); ++it) {
+                MappedDealsManifest::Day manifest_day;
+                manifest_day.timestamp = it->first;
+                manifest_day.segment = it->second;
+                manifest.days.push_back(manifest_day);
+                segments.insert(it->second);
+            }
+            manifest.segments.assign(segments.begin(), segments.end());
+            manifest.generation = segment;
+            err = manifest.save(path);
+            if(err != OK) return err;
+            snapshot_days.clear();
+
+            /* сегменты без дней больше не нужны новым читателям. Читатели старого снимка
+             * продолжают работать с отображенными файлами, в Windows такие файлы не удалятся
+             */
+            if(segments.count(segment) == 0) std::remove(MappedDealsManifest::get_segment_path(path, segment).c_str());
+            for(size_t i = 0; i < old_segments.size(); ++i) {
+                if(segments.count(old_segments[i]) == 0) {
+                    std::remove(MappedDealsManifest::get_segment_path(path, old_segments[i]).c_str());
+                }
+            }
+            return OK;
+        }
+
+        /** \brief Перейти к последнему опубликованному снимку
          *
-         * Метод  принудительно сохраняет все данные, которые еще не записаны в файл а находятся только в буфере.
+         * Метод доступен только для хранилища, отображенного в память (MappedDealsDataStore),
+         * открытого по манифесту снимков. Массивы сделок, полученные методом get_deals_view, становятся недействительными
+         * \return Вернет код ошибки
          */
-        int save() {
-			if(list_write_deals.size() > 0 && date_timestamp != 0) {
-				/* данные уже есть! Придется сначала прочитать старые данные */
-				std::vector<Deal> temp;
-				if(check_timestamp(date_timestamp)) {
-
-#                   if(0)
-                    /* данные изменения связаны с тем, что в случае
-                     * отсутствия сделок, метод read_deals
-                     * возвращает код ошибки
-                     */
-                    int err = read_deals<STORAGE_TYPE>(temp, date_timestamp);
-                    if(err != xquotes_common::OK) {
-                        iStorage.save();
-                        return err;
-                    }
-#                   else
-                    read_deals<STORAGE_TYPE>(temp, date_timestamp);
-#                   endif
-
-                    /* добавим во временный массив не повторяющиеся сделки */
-                    if(temp.size() > 0) {
-                        for(size_t i = 0; i < list_write_deals.size(); ++i) {
-                            if(!check_repeat_deal(temp, list_write_deals[i])) {
-                                temp.push_back(list_write_deals[i]);
-                                /* ужасно не оптимальный код */
-                                sort_list_deals(temp);
-                            }
-                        }
-                    } else {
-                        temp = list_write_deals;
-                        if(temp.size() > 0) sort_list_deals(temp);
-                    }
-				} else {
-                    temp = list_write_deals;
-                    if(temp.size() > 0) sort_list_deals(temp);
-				}
-				/* а теперь все обратно запишем */
-				int err = write_deals<STORAGE_TYPE>(temp, date_timestamp);
-				if(err != xquotes_common::OK) {
-					iStorage.save();
-					return err;
-				}
-			}
-            iStorage.save();
+        template<class T = STORAGE_TYPE, typename std::enable_if<std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        int refresh_snapshot() {
+            bool is_changed = false;
+            int err = iStorage.refresh(is_changed);
+            if(err != OK || !is_changed) return err;
+            day_cache.clear();
+            calendar.clear();
+            symbol_catalog.clear();
+            is_symbol_catalog = false;
             return OK;
         }
 
-        /** \brief Получить сделки за указанный торговый день
-         *
-         * \param list_deals Массив сделок
-         * \param timestamp Дата
-         * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
-         * \return Вернет код ошибки
+        /** \brief Получить номер поколения открытого снимка
+         * \return Номер поколения или 0, если снимок не открыт
          */
-        int get_deals(
-                std::vector<Deal> &list_deals,
-                const xtime::timestamp_t timestamp,
-                std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
-            if(!check_timestamp(timestamp)) return easy_bo::NO_DATA_ACCESS;
-            int err = read_deals<STORAGE_TYPE>(list_deals, timestamp);
-            if(err != easy_bo::OK) return err;
-            sort_list_deals(list_deals);
-            if(callback != nullptr) callback(list_deals);
-            if(list_deals.size() == 0) return easy_bo::NO_DATA_ACCESS;
-            return easy_bo::OK;
+        template<class T = STORAGE_TYPE, typename std::enable_if<std::is_same<T, MappedDealsStorage>::value>::type* = nullptr>
+        inline uint64_t get_snapshot_generation() const {
+            return iStorage.get_generation();
         }
 
         /** \brief Торгуем день
@@ -315,6 +1832,7 @@ namespace easy_bo {
          * \param callback Лямбда-функция для обратного вызова.
          * Она принимает массивы сделок по метке времени
          * \param step Шаг времени
+         * \param flags Режим торговли (см. TRADE_EXACT_TIMESTAMP, TRADE_BUCKETS, TRADE_EMPTY_SLOTS)
          * \return Код ошибки
          */
         int trade(
@@ -322,37 +1840,27 @@ namespace easy_bo {
                 std::function<void(
                     std::vector<Deal> &deals,
                     const xtime::timestamp_t timestamp)> callback,
-                const xtime::timestamp_t step = xtime::SECONDS_IN_MINUTE) {
-
+                const xtime::timestamp_t step = xtime::SECONDS_IN_MINUTE,
+                const uint32_t flags = TRADE_EXACT_TIMESTAMP) {
+            if(step == 0) return easy_bo::INVALID_PARAMETER;
             const xtime::timestamp_t start = xtime::get_first_timestamp_day(timestamp);
             if(!check_timestamp(start)) return easy_bo::NO_DATA_ACCESS;
             std::vector<Deal> list_deals;
-            int err = read_deals<STORAGE_TYPE>(list_deals, start);
+            int err = read_day_deals(list_deals, start);
             if(err != easy_bo::OK) return err;
-            sort_list_deals(list_deals);
-            std::vector<Deal> temp;
-            temp.reserve(list_deals.size());
-            const xtime::timestamp_t stop = start + xtime::SECONDS_IN_DAY;
-            for(xtime::timestamp_t t = start; t < stop; t += step) {
-                /* формируем список для каждой минуты дня */
-                auto it = find_deal(list_deals, t);
-                if(it == list_deals.end()) continue;
-                temp.clear();
-                const size_t offset = it - list_deals.begin();
-                for(size_t i = offset; i < list_deals.size(); ++i) {
-                    if(list_deals[i].timestamp == t) temp.push_back(list_deals[i]);
-                }
-                if(temp.size() > 0) callback(temp, t);
-            }
+            trade_day(list_deals, start, callback, step, flags);
             return easy_bo::OK;
         }
 
         /** \brief Торговать за указанный период
          *
+         * Если включено упреждающее чтение (см. set_prefetch), следующие дни декодируются,
+         * пока обработчик торгует текущий день
          * \param start_date_timestamp Начальная дата
          * \param stop_date_timestamp Конечная дата
          * \param callback Обработчик сделок
          * \param step Шаг времени внутри дня, по умолчанию минута
+         * \param flags Режим торговли (см. TRADE_EXACT_TIMESTAMP, TRADE_BUCKETS, TRADE_EMPTY_SLOTS)
          * \return Вернет 0 если были данные
          */
         int trade(
@@ -361,14 +1869,21 @@ namespace easy_bo {
                 std::function<void(
                         std::vector<Deal> &deals,
                         const xtime::timestamp_t timestamp)> callback,
-                const xtime::timestamp_t step = xtime::SECONDS_IN_MINUTE) {
+                const xtime::timestamp_t step = xtime::SECONDS_IN_MINUTE,
+                const uint32_t flags = TRADE_EXACT_TIMESTAMP) {
+            if(step == 0) return easy_bo::INVALID_PARAMETER;
             const xtime::timestamp_t end_timestamp = xtime::get_first_timestamp_day(stop_date_timestamp);
+            std::vector<xtime::timestamp_t> days;
+            get_calendar().get_days(days, start_date_timestamp, end_timestamp);
+            DaysReader days_reader(this, days, ColumnDeals::COLUMN_ALL);
+            std::vector<Deal> list_deals;
             int counter = 0;
-            for(xtime::timestamp_t t = xtime::get_first_timestamp_day(start_date_timestamp);
-                t <= end_timestamp;
-                t += xtime::SECONDS_IN_DAY) {
-                int err = trade(t, callback, step);
-                if(err == easy_bo::OK) ++counter;
+            while(!days_reader.end()) {
+                xtime::timestamp_t t = 0;
+                int err = days_reader.read(list_deals, t);
+                if(err != easy_bo::OK) continue;
+                trade_day(list_deals, t, callback, step, flags);
+                ++counter;
             }
             if(counter == 0) return easy_bo::NO_DATA_ACCESS;
             return easy_bo::OK;
@@ -388,36 +1903,23 @@ namespace easy_bo {
 			xtime::timestamp_t max_timestamp = 0;
 			int err = get_min_max_timestamp(min_timestamp, max_timestamp);
 			if(err != xquotes_common::OK) return err;
-			xtime::timestamp_t timestamp = xtime::get_first_timestamp_day(stop_timestamp) - xtime::SECONDS_IN_DAY;
-			const xtime::timestamp_t protection_timestamp = xtime::get_last_timestamp_day(timestamp);
-			while(timestamp >= min_timestamp) {
-				/* проверяем доступность данных за требуемую дату */
-				if(!check_timestamp(timestamp)) {
-					timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
+			const xtime::timestamp_t protection_timestamp = xtime::get_last_timestamp_day(
+				xtime::get_first_timestamp_day(stop_timestamp) - xtime::SECONDS_IN_DAY);
+			/* проходим только по дням, которые есть в хранилище */
+			std::vector<xtime::timestamp_t> days;
+			get_calendar().get_days_before(days, stop_timestamp);
+			for(size_t i = 0; i < days.size(); ++i) {
 				/* загружаем данные за торговый день */
 				std::vector<Deal> temp;
-				err = read_deals<STORAGE_TYPE>(temp, timestamp);
-				if(err != xquotes_common::OK) {
-					timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
+				err = read_day_deals(temp, days[i]);
+				if(err != xquotes_common::OK) continue;
 				/* удаляем те сделки, которые выходят
 				 * за максимально допустимую дату
 				 */
-				size_t temp_index = 0;
-				while(temp_index < temp.size()) {
-					const xtime::timestamp_t last_timestamp =
-						temp[temp_index].timestamp + temp[temp_index].duration;
-					if(last_timestamp > protection_timestamp) {
-						temp.erase(temp.begin() + temp_index);
-						continue;
-					}
-					++temp_index;
-				}
+				temp.erase(std::remove_if(temp.begin(), temp.end(), [protection_timestamp](const Deal &deal) {
+					return (deal.timestamp + deal.duration) > protection_timestamp;
+				}), temp.end());
 				if(!callback(temp)) break;
-				timestamp -= xtime::SECONDS_IN_DAY;
 			}
 			return OK;
 		}
@@ -426,74 +1928,79 @@ namespace easy_bo {
          *
          * Данный метод загрузит вектор сделок за указанное количество дней. Текущий день не учитывается.
 		 * Также метод отсортирует сделки по времени и удалит те сделки, которые "подсматривают" за последнюю дату.
+		 * Учитываются только дни, в которых остались сделки после отбора
          * \param list_deals Массив сделок
+		 * \param query Условия отбора сделок (см. DealsQuery)
 		 * \param days Количество дней
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_deals_days(
 				std::vector<Deal> &list_deals,
+				const DealsQuery &query,
 				const uint32_t days,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			list_deals.clear();
 			xtime::timestamp_t min_timestamp = 0;
 			xtime::timestamp_t max_timestamp = 0;
 			int err = get_min_max_timestamp(min_timestamp, max_timestamp);
 			if(err != xquotes_common::OK) return err;
-			xtime::timestamp_t timestamp = xtime::get_first_timestamp_day(stop_timestamp) - xtime::SECONDS_IN_DAY;
+			const xtime::timestamp_t timestamp = xtime::get_first_timestamp_day(stop_timestamp) - xtime::SECONDS_IN_DAY;
 			const xtime::timestamp_t protection_timestamp = xtime::get_last_timestamp_day(timestamp);
-			uint32_t day = 0;
-			while(day < days && timestamp >= min_timestamp) {
-				/* проверяем доступность данных за требуемую дату */
-				if(!check_timestamp(timestamp)) {
-					timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
-				/* загружаем данные за торговый день */
-				std::vector<Deal> temp;
-				err = read_deals<STORAGE_TYPE>(temp, timestamp);
-				if(err != xquotes_common::OK) {
-					timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
-				/* обрабатываем данные */
-				size_t temp_index = 0;
-				while(temp_index < temp.size()) {
-					const xtime::timestamp_t last_timestamp =
-						temp[temp_index].timestamp + temp[temp_index].duration;
-					if(last_timestamp > protection_timestamp) {
-						temp.erase(temp.begin() + temp_index);
-						continue;
-					}
-					++temp_index;
-				}
-				if(temp.size() != 0 && callback != nullptr) callback(temp);
-				/* пропускаем этот день без сделок */
-				if(temp.size() == 0) {
-                    timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
-
-				/* добавлям данные в общий вектор */
-				if(temp.size() > 0) list_deals.insert(list_deals.end(), temp.begin(), temp.end());
-
-				timestamp -= xtime::SECONDS_IN_DAY;
-				++day;
+			DealsCursor cursor(
+				this,
+				min_timestamp,
+				protection_timestamp,
+				DealsCursor::BACKWARD,
+				callback,
+				columns,
+				query);
+			/* дни идут от последнего к первому, каждый день уже отсортирован */
+			std::vector<std::vector<Deal>> list_days;
+			size_t amount_deals = 0;
+			std::vector<Deal> temp;
+			xtime::timestamp_t day_timestamp = 0;
+			while(list_days.size() < days && cursor.next_day(temp, day_timestamp)) {
+				amount_deals += temp.size();
+				list_days.push_back(std::move(temp));
+				temp.clear();
 			}
-			if(day < days) {
-				list_deals.clear();
-				return NO_DATA_ACCESS;
+			if(list_days.size() < days || amount_deals == 0) return NO_DATA_ACCESS;
+			list_deals.reserve(amount_deals);
+			for(auto it = list_days.rbegin(); it != list_days.rend(); ++it) {
+				list_deals.insert(list_deals.end(), it->begin(), it->end());
 			}
-			if(list_deals.size() == 0) return NO_DATA_ACCESS;
-			/* сортируем данные */
+			/* пользовательский фильтр мог нарушить порядок сделок */
 			sort_list_deals(list_deals);
 			return OK;
 		}
 
 		/** \brief Получить сделки за указанное количество дней
          *
+         * Данный метод загрузит вектор сделок за указанное количество дней. Текущий день не учитывается.
+		 * Также метод отсортирует сделки по времени и удалит те сделки, которые "подсматривают" за последнюю дату.
+         * \param list_deals Массив сделок
+		 * \param days Количество дней
+         * \param stop_timestamp Конечная дата
+		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+		int get_deals_days(
+				std::vector<Deal> &list_deals,
+				const uint32_t days,
+				const xtime::timestamp_t stop_timestamp,
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
+			return get_deals_days(list_deals, DealsQuery(), days, stop_timestamp, callback, columns);
+		}
+
+		/** \brief Получить сделки за указанное количество дней
+         *
          * Данный метод загрузит вектор сделок за указанное количество дней. Текущий день не учитывается.
 		 * Также метод отсортирует сделки по времени и удалит те сделки, которые "подсматривают" за последнюю дату.
          * \param list_deals Массив сделок
@@ -503,6 +2010,7 @@ namespace easy_bo {
 		 * \param days Количество дней
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_deals_days(
@@ -512,28 +2020,15 @@ namespace easy_bo {
 				const uint32_t stop_minute_day,
 				const uint32_t days,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			return get_deals_days(
 				list_deals,
+				DealsQuery().symbol(symbol_index).minute_day(start_minute_day, stop_minute_day),
 				days,
 				stop_timestamp,
-				[&](std::vector<Deal> &temp) {
-					/* удаляем ненужные данные */
-					size_t temp_index = 0;
-					while(temp_index < temp.size()) {
-						if(symbol_index != temp[temp_index].symbol) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						const uint32_t minute_day = xtime::get_minute_day(temp[temp_index].timestamp);
-						if(start_minute_day > minute_day || minute_day >= stop_minute_day) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						++temp_index;
-					}
-					if(temp.size() != 0 && callback != nullptr) callback(temp);
-				});
+				callback,
+				columns);
 		}
 
 		/** \brief Получить последние сделки за указанное количество дней
@@ -547,6 +2042,7 @@ namespace easy_bo {
 		 * \param days Количество дней
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_deals_days(
@@ -556,28 +2052,15 @@ namespace easy_bo {
 				const uint32_t stop_minute_day,
 				const uint32_t days,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			return get_deals_days(
 				list_deals,
+				DealsQuery().name(symbol_name).minute_day(start_minute_day, stop_minute_day),
 				days,
 				stop_timestamp,
-				[&](std::vector<Deal> &temp) {
-					/* удаляем ненужные данные */
-					size_t temp_index = 0;
-					while(temp_index < temp.size()) {
-						if(symbol_name != temp[temp_index].get_name()) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						const uint32_t minute_day = xtime::get_minute_day(temp[temp_index].timestamp);
-						if(start_minute_day > minute_day || minute_day >= stop_minute_day) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						++temp_index;
-					}
-					if(temp.size() != 0 && callback != nullptr) callback(temp);
-				});
+				callback,
+				columns);
 		}
 
 		/** \brief Получить сделки за указанное количество дней
@@ -590,6 +2073,7 @@ namespace easy_bo {
 		 * \param days Количество дней
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_deals_days(
@@ -598,24 +2082,15 @@ namespace easy_bo {
 				const uint32_t stop_minute_day,
 				const uint32_t days,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			return get_deals_days(
 				list_deals,
+				DealsQuery().minute_day(start_minute_day, stop_minute_day),
 				days,
 				stop_timestamp,
-				[&](std::vector<Deal> &temp) {
-					/* удаляем ненужные данные */
-					size_t temp_index = 0;
-					while(temp_index < temp.size()) {
-						const uint32_t minute_day = xtime::get_minute_day(temp[temp_index].timestamp);
-						if(start_minute_day > minute_day || minute_day >= stop_minute_day) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						++temp_index;
-					}
-					if(temp.size() != 0 && callback != nullptr) callback(temp);
-				});
+				callback,
+				columns);
 		}
 
 		/** \brief Получить винрейт за указанное количество дней
@@ -635,8 +2110,41 @@ namespace easy_bo {
 				const xtime::timestamp_t stop_timestamp,
 				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
 			winrate = 0;
+			int err = OK;
+			if(callback == nullptr && get_summary_winrate(err, winrate, days, stop_timestamp)) return err;
+			std::vector<Deal> list_deals;
+			err = get_deals_days(list_deals, days, stop_timestamp, callback, get_winrate_columns(callback));
+			if(err != OK) return err;
+			easy_bo::SimplifedTester<uint32_t> tester;
+			for(size_t i = 0; i < list_deals.size(); ++i) {
+				if(list_deals[i].result == EASY_BO_WIN) tester.add_deal(easy_bo::EASY_BO_WIN);
+				else tester.add_deal(easy_bo::EASY_BO_LOSS);
+			}
+			winrate = tester.get_winrate<T>();
+			return OK;
+		}
+
+		/** \brief Получить винрейт за указанное количество дней
+         *
+         * Данный метод получит винрейт сделок, удовлетворяющих запросу, за указанное количество дней.
+		 * Текущий день не учитывается. Сделки декодируются только в колонках, нужных запросу и расчету винрейта.
+         * \param winrate Винрейт
+		 * \param query Условия отбора сделок (см. DealsQuery)
+		 * \param days Количество дней
+         * \param stop_timestamp Конечная дата
+		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+		template<class T>
+		int get_winrate_days(
+				T &winrate,
+				const DealsQuery &query,
+				const uint32_t days,
+				const xtime::timestamp_t stop_timestamp,
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+			winrate = 0;
 			std::vector<Deal> list_deals;
-			int err = get_deals_days(list_deals, days, stop_timestamp, callback);
+			int err = get_deals_days(list_deals, query, days, stop_timestamp, callback, get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -668,14 +2176,23 @@ namespace easy_bo {
 				const xtime::timestamp_t stop_timestamp,
 				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
 			winrate = 0;
+			int err = OK;
+			if(callback == nullptr && get_summary_winrate(
+				err,
+				winrate,
+				days,
+				stop_timestamp,
+				start_minute_day,
+				stop_minute_day)) return err;
 			std::vector<Deal> list_deals;
-			int err = get_deals_days(
+			err = get_deals_days(
 				list_deals,
 				start_minute_day,
 				stop_minute_day,
 				days,
 				stop_timestamp,
-				callback);
+				callback,
+				get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -709,15 +2226,27 @@ namespace easy_bo {
 				const xtime::timestamp_t stop_timestamp,
 				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
 			winrate = 0;
+			int err = OK;
+			if(callback == nullptr &&
+				symbol_index <= std::numeric_limits<uint8_t>::max() &&
+				get_summary_winrate(
+					err,
+					winrate,
+					days,
+					stop_timestamp,
+					start_minute_day,
+					stop_minute_day,
+					symbol_index)) return err;
 			std::vector<Deal> list_deals;
-			int err = get_deals_days(
+			err = get_deals_days(
 				list_deals,
 				symbol_index,
 				start_minute_day,
 				stop_minute_day,
 				days,
 				stop_timestamp,
-				callback);
+				callback,
+				get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -751,15 +2280,30 @@ namespace easy_bo {
 				const xtime::timestamp_t stop_timestamp,
 				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
 			winrate = 0;
+			int err = OK;
+			if(callback == nullptr) {
+				Deal symbol_deal;
+				symbol_deal.set_name(symbol_name);
+				if(get_summary_winrate(
+					err,
+					winrate,
+					days,
+					stop_timestamp,
+					start_minute_day,
+					stop_minute_day,
+					-1,
+					symbol_deal.name)) return err;
+			}
 			std::vector<Deal> list_deals;
-			int err = get_deals_days(
+			err = get_deals_days(
 				list_deals,
 				symbol_name,
 				start_minute_day,
 				stop_minute_day,
 				days,
 				stop_timestamp,
-				callback);
+				callback,
+				get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -800,7 +2344,8 @@ namespace easy_bo {
 				stop_minute_day,
 				days,
 				stop_timestamp,
-				callback);
+				callback,
+				get_winrate_columns(callback));
 			if(err != OK) return err;
 			winrate_array.resize(days);
 			easy_bo::SimplifedTester<uint32_t> tester;
@@ -849,25 +2394,14 @@ namespace easy_bo {
 			std::vector<Deal> list_deals; // не будет использован
 			int err = get_deals_days(
 				list_deals,
+				DealsQuery().minute_day(start_minute_day, stop_minute_day),
 				days,
 				stop_timestamp,
 				[&](std::vector<Deal> &temp) {
-					/* получаем данные за один день
-					 * и сначала удалим из данных лишние минуты
-					 */
-					size_t temp_index = 0;
-					while(temp_index < temp.size()) {
-						const uint32_t minute_day = xtime::get_minute_day(temp[temp_index].timestamp);
-						if(start_minute_day > minute_day || minute_day >= stop_minute_day) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						++temp_index;
-					}
-					/* далее, если еще что-то осталось от данных,
+					/* лишние минуты уже удалены запросом,
 					 * вызовем пользователькую функцию фильтра
 					 */
-					if(temp.size() != 0 && callback != nullptr) callback(temp);
+					if(callback != nullptr) callback(temp);
 					if(temp.size() != 0) {
                         /* далее обработаем все символы */
                         for(size_t symbol_index = 0; symbol_index < symbols_index.size(); ++symbol_index) {
@@ -881,7 +2415,10 @@ namespace easy_bo {
                         }
                         ++day;
                     }
-				});
+				},
+				callback == nullptr ?
+					(ColumnDeals::COLUMN_RESULT | ColumnDeals::COLUMN_SYMBOL) :
+					ColumnDeals::COLUMN_ALL);
             if(err == OK) {
                 for(size_t i = 0; i < winrate_arrays.size(); ++i) {
                     std::reverse(winrate_arrays[i].begin(), winrate_arrays[i].end());
@@ -895,72 +2432,75 @@ namespace easy_bo {
          * * Данный метод загрузит вектор сделок заданного размера.
 		 * Также метод отсортирует сделки по времени и удалит те сделки, которые "подсматривают" в будущее (за указанную метку времени)
          * \param list_deals Массив сделок
+		 * \param query Условия отбора сделок (см. DealsQuery)
 		 * \param number_deals Количество сделок
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_fixed_number_deals(
 				std::vector<Deal> &list_deals,
+				const DealsQuery &query,
 				const uint32_t number_deals,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			list_deals.clear();
 			xtime::timestamp_t min_timestamp = 0;
 			xtime::timestamp_t max_timestamp = 0;
 			int err = get_min_max_timestamp(min_timestamp, max_timestamp);
 			if(err != xquotes_common::OK) return err;
-			xtime::timestamp_t timestamp = xtime::get_first_timestamp_day(stop_timestamp);
-			const xtime::timestamp_t protection_timestamp = stop_timestamp;
-			while(timestamp >= min_timestamp) {
-				/* проверяем доступность данных за требуемую дату */
-				if(!check_timestamp(timestamp)) {
-					timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
-
-				/* загружаем данные за торговый день */
-				std::vector<Deal> temp;
-				err = read_deals<STORAGE_TYPE>(temp, timestamp);
-				if(err != xquotes_common::OK) {
-					timestamp -= xtime::SECONDS_IN_DAY;
-					continue;
-				}
-
-				/* обрабатываем данные */
-				size_t temp_index = 0;
-				while(temp_index < temp.size()) {
-					const xtime::timestamp_t last_timestamp =
-						temp[temp_index].timestamp + temp[temp_index].duration;
-					if(last_timestamp > protection_timestamp) {
-						temp.erase(temp.begin() + temp_index);
-						continue;
-					}
-					++temp_index;
-				}
-				if(temp.size() != 0 && callback != nullptr) callback(temp);
-
-				/* добавлям данные в общий вектор */
-				if(temp.size() > 0) list_deals.insert(list_deals.end(), temp.begin(), temp.end());
-				if(list_deals.size() >= number_deals) break;
-
-				timestamp -= xtime::SECONDS_IN_DAY;
-			}
-			if(list_deals.size() < number_deals) {
-				list_deals.clear();
-				return NO_DATA_ACCESS;
+			DealsCursor cursor(
+				this,
+				min_timestamp,
+				stop_timestamp,
+				DealsCursor::BACKWARD,
+				callback,
+				columns,
+				query);
+			/* дни идут от последнего к первому, каждый день уже отсортирован */
+			std::vector<std::vector<Deal>> list_days;
+			size_t amount_deals = 0;
+			std::vector<Deal> temp;
+			xtime::timestamp_t day_timestamp = 0;
+			while(amount_deals < number_deals && cursor.next_day(temp, day_timestamp)) {
+				amount_deals += temp.size();
+				list_days.push_back(std::move(temp));
+				temp.clear();
 			}
-			/* сортируем данные */
-			std::sort(list_deals.begin(), list_deals.end(), [](const Deal &lhs, const Deal &rhs) {
-                return lhs.timestamp < rhs.timestamp;
-            });
-			if(list_deals.size() != number_deals) {
-				const size_t offset = list_deals.size() - number_deals;
-				list_deals.erase(list_deals.begin(), list_deals.begin() + offset);
+			if(amount_deals < number_deals) return NO_DATA_ACCESS;
+			list_deals.reserve(amount_deals);
+			for(auto it = list_days.rbegin(); it != list_days.rend(); ++it) {
+				list_deals.insert(list_deals.end(), it->begin(), it->end());
 			}
+			sort_list_deals(list_deals);
+			/* оставляем только последние сделки */
+			const size_t offset = list_deals.size() - number_deals;
+			if(offset > 0) list_deals.erase(list_deals.begin(), list_deals.begin() + offset);
 			return OK;
 		}
 
+		/** \brief Получить фиксированное количество сделок
+         *
+         * * Данный метод загрузит вектор сделок заданного размера.
+		 * Также метод отсортирует сделки по времени и удалит те сделки, которые "подсматривают" в будущее (за указанную метку времени)
+         * \param list_deals Массив сделок
+		 * \param number_deals Количество сделок
+         * \param stop_timestamp Конечная дата
+		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+		int get_fixed_number_deals(
+				std::vector<Deal> &list_deals,
+				const uint32_t number_deals,
+				const xtime::timestamp_t stop_timestamp,
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
+			return get_fixed_number_deals(list_deals, DealsQuery(), number_deals, stop_timestamp, callback, columns);
+		}
+
 		/** \brief Получить сделки за указанное количество дней
          *
          * Данный метод загрузит вектор сделок заданного размера.
@@ -972,6 +2512,7 @@ namespace easy_bo {
 		 * \param number_deals Количество сделок
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_fixed_number_deals(
@@ -981,28 +2522,15 @@ namespace easy_bo {
 				const uint32_t stop_minute_day,
 				const uint32_t number_deals,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			return get_fixed_number_deals(
 				list_deals,
+				DealsQuery().symbol(symbol_index).minute_day(start_minute_day, stop_minute_day),
 				number_deals,
 				stop_timestamp,
-				[&](std::vector<Deal> &temp) {
-					/* удаляем ненужные данные */
-					size_t temp_index = 0;
-					while(temp_index < temp.size()) {
-						if(symbol_index != temp[temp_index].symbol) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						const uint32_t minute_day = xtime::get_minute_day(temp[temp_index].timestamp);
-						if(start_minute_day > minute_day || minute_day >= stop_minute_day) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						++temp_index;
-					}
-					if(temp.size() != 0 && callback != nullptr) callback(temp);
-				});
+				callback,
+				columns);
 		}
 
 		/** \brief Получить последние сделки за указанное количество дней
@@ -1016,6 +2544,7 @@ namespace easy_bo {
 		 * \param number_deals Количество сделок
          * \param stop_timestamp Конечная дата
 		 * \param callback Функция для обратного вызова, можно использовать для дополнительной фильтрации сделок
+		 * \param columns Набор колонок, которые нужно прочитать (см. ColumnDeals)
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int get_fixed_number_deals(
@@ -1025,28 +2554,15 @@ namespace easy_bo {
 				const uint32_t stop_minute_day,
 				const uint32_t number_deals,
 				const xtime::timestamp_t stop_timestamp,
-				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
+				std::function<void(std::vector<Deal> &deals)> callback = nullptr,
+				const uint32_t columns = ColumnDeals::COLUMN_ALL) {
 			return get_fixed_number_deals(
 				list_deals,
+				DealsQuery().name(symbol_name).minute_day(start_minute_day, stop_minute_day),
 				number_deals,
 				stop_timestamp,
-				[&](std::vector<Deal> &temp) {
-					/* удаляем ненужные данные */
-					size_t temp_index = 0;
-					while(temp_index < temp.size()) {
-						if(symbol_name != temp[temp_index].get_name()) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						const uint32_t minute_day = xtime::get_minute_day(temp[temp_index].timestamp);
-						if(start_minute_day > minute_day || minute_day >= stop_minute_day) {
-							temp.erase(temp.begin() + temp_index);
-							continue;
-						}
-						++temp_index;
-					}
-					if(temp.size() != 0 && callback != nullptr) callback(temp);
-				});
+				callback,
+				columns);
 		}
 
 		/** \brief Получить винрейт за указанное количество дней
@@ -1067,7 +2583,7 @@ namespace easy_bo {
 				std::function<void(std::vector<Deal> &deals)> callback = nullptr) {
 			winrate = 0;
 			std::vector<Deal> list_deals;
-			int err = get_fixed_number_deals(list_deals, number_deals, stop_timestamp, callback);
+			int err = get_fixed_number_deals(list_deals, number_deals, stop_timestamp, callback, get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -1109,7 +2625,8 @@ namespace easy_bo {
 				stop_minute_day,
 				number_deals,
 				stop_timestamp,
-				callback);
+				callback,
+				get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -1151,7 +2668,8 @@ namespace easy_bo {
 				stop_minute_day,
 				number_deals,
 				stop_timestamp,
-				callback);
+				callback,
+				get_winrate_columns(callback));
 			if(err != OK) return err;
 			easy_bo::SimplifedTester<uint32_t> tester;
 			for(size_t i = 0; i < list_deals.size(); ++i) {
@@ -1169,67 +2687,302 @@ namespace easy_bo {
 		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
 		int add_deal(const Deal& deal) {
-			if(date_timestamp != xtime::get_first_timestamp_day(deal.timestamp)) {
-				/* если новый день, то пора загрузить предыдущие данные в хранилище
-				 * но сначала их надо слить с теми данными, что уже есть в хранилище (если они есть)
- 				 */
-				if(!check_timestamp(date_timestamp)) {
-					/* если данных еще нет в хранилище за указанную дату,
-					 * тогда просто запишем то, что есть
-					 * очистим массив сделок и запишем в него новую сделку
-					 */
-					if(list_write_deals.size() != 0) {
-						sort_list_deals(list_write_deals); // посортируем массив преде записью
-						int err = write_deals<STORAGE_TYPE>(list_write_deals, date_timestamp);
-						if(err != xquotes_common::OK) return err;
-						list_write_deals.clear();
-					}
-					list_write_deals.push_back(deal);
-				} else {
-					/* данные уже есть! Придется сначала прочитать старые данные */
-					std::vector<Deal> temp;
-					int err = read_deals<STORAGE_TYPE>(temp, date_timestamp);
-					if(err != xquotes_common::OK) return err;
-					/* добавим во временный массив не повторяющиеся сделки */
-					if(temp.size() > 0) {
-						for(size_t i = 0; i < list_write_deals.size(); ++i) {
-							if(!check_repeat_deal(temp, list_write_deals[i])) {
-								temp.push_back(list_write_deals[i]);
-								/* ужасно не оптимальный код */
-								sort_list_deals(temp);
-							}
-						}
-					} else {
-						temp = list_write_deals;
-						if(temp.size() > 0) sort_list_deals(temp);
-					}
-					/* а теперь все обратно запишем */
-					err = write_deals<STORAGE_TYPE>(temp, date_timestamp);
-					if(err != xquotes_common::OK) return err;
-					/* теперь очистим массив сделок и добавим новую сделку за новую дату */
-					list_write_deals.clear();
-					list_write_deals.push_back(deal);
+			/* одиночная сделка сразу передается ОС */
+			if(is_journal) {
+				int err = journal.append(deal);
+				if(err != xquotes_common::OK) return err;
+			}
+			return buffer_deal(deal);
+		}
+
+		/** \brief Добавить массив сделок
+         *
+         * Метод не пропускает повторяющиеся сделки. Сделки группируются по дням,
+         * поэтому каждый день записывается в хранилище один раз даже для неупорядоченного массива.
+         * Время работы метода учитывается в статистике записи (см. get_ingest_stats)
+         * \param begin Итератор начала массива сделок
+         * \param end Итератор конца массива сделок
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+		template<class ITERATOR>
+		int add_deals(ITERATOR begin, ITERATOR end) {
+			const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+			/* проверяем, что сделки идут по дням */
+			bool is_days_sorted = true;
+			xtime::timestamp_t last_date_timestamp = 0;
+			for(ITERATOR it = begin; it != end; ++it) {
+				const xtime::timestamp_t deal_date_timestamp = xtime::get_first_timestamp_day(it->timestamp);
+				if(deal_date_timestamp < last_date_timestamp) {
+					is_days_sorted = false;
+					break;
+				}
+				last_date_timestamp = deal_date_timestamp;
+			}
+
+			/* журнал получает весь массив одной записью */
+			int err = is_journal ? journal.append(begin, end) : OK;
+			if(err != OK) return err;
+			if(is_days_sorted) {
+				for(ITERATOR it = begin; it != end; ++it) {
+					err = buffer_deal(*it);
+					if(err != OK) break;
 				}
-				date_timestamp = xtime::get_first_timestamp_day(deal.timestamp);
 			} else {
-				/* Если та же самая дата, просто добавим сделку, предварительно проверив на совпадение */
-				if(check_repeat_deal(list_write_deals, deal)) return OK;
-				list_write_deals.push_back(deal);
-				/* хрен с ним, с идеальным кодом */
-				sort_list_deals(list_write_deals);
+				std::vector<Deal> temp(begin, end);
+				std::stable_sort(temp.begin(), temp.end(),
+					[](const Deal &a, const Deal &b) {
+						return xtime::get_first_timestamp_day(a.timestamp) <
+							xtime::get_first_timestamp_day(b.timestamp);
+					});
+				for(size_t i = 0; i < temp.size(); ++i) {
+					err = buffer_deal(temp[i]);
+					if(err != OK) break;
+				}
+			}
+			ingest_stats.seconds += std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start_time).count();
+			return err;
+		}
+
+		/** \brief Добавить массив сделок
+		 * \param list_deals Массив сделок
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int add_deals(const std::vector<Deal> &list_deals) {
+			return add_deals(list_deals.begin(), list_deals.end());
+		}
+
+		/** \brief Получить статистику записи сделок
+		 * \return Статистика записи сделок
+		 */
+		inline const DealsIngestStats &get_ingest_stats() const {
+			return ingest_stats;
+		}
+
+		/** \brief Сбросить статистику записи сделок
+		 */
+		inline void clear_ingest_stats() {
+			ingest_stats = DealsIngestStats();
+		}
+
+		/** \brief Разрешить запись повторяющихся сделок
+		 *
+		 * По умолчанию повторы сделок отсекаются при добавлении. Если источник сделок
+		 * заведомо не дает повторов, проверку можно отключить, тогда сделки записываются как есть.
+		 * Перед сменой режима буфер записи сохраняется в хранилище
+		 * \param value Разрешить повторы
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int set_allow_duplicates(const bool value) {
+			if(value == is_allow_duplicates) return OK;
+			int err = flush_write_deals();
+			if(err != OK) return err;
+			is_allow_duplicates = value;
+			return OK;
+		}
+
+		/** \brief Проверить, разрешена ли запись повторяющихся сделок
+		 * \return Вернет true, если повторы не проверяются
+		 */
+		inline bool get_allow_duplicates() const {
+			return is_allow_duplicates;
+		}
+
+		/** \brief Установить количество дней в буфере записи
+		 *
+		 * Буфер записи держит несколько дней, поэтому сделки разных дней, идущие вперемешку
+		 * (например, догрузка истории от нескольких стратегий), не вызывают перезапись дня при каждой смене дня.
+		 * При переполнении буфера в хранилище записывается день, к которому дольше всего не обращались.
+		 * Каждый день буфера держит в памяти свои новые и уже записанные сделки
+		 * \param days Количество дней, по умолчанию DealsWriteCache::DEFAULT_MAX_DAYS. Значение 1 - буфер одного дня
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int set_write_cache_days(const uint32_t days) {
+			write_cache.set_max_days(days);
+			while(write_cache.size() > write_cache.get_max_days()) {
+				int err = flush_write_day(write_cache.get_oldest());
+				if(err != OK) return err;
+			}
+			return OK;
+		}
+
+		inline uint32_t get_write_cache_days() const {return write_cache.get_max_days();};
+
+		/** \brief Установить максимальный объем кэша декодированных дней
+		 *
+		 * Кэш ускоряет повторные запросы пересекающихся интервалов дней.
+		 * Значение 0 отключает кэш
+		 * \param bytes Объем кэша в байтах
+		 */
+		inline void set_day_cache_size(const size_t bytes) {
+			day_cache.set_max_bytes(bytes);
+		}
+
+		/** \brief Получить кэш декодированных дней
+		 *
+		 * Позволяет узнать количество попаданий и промахов кэша
+		 * \return Кэш декодированных дней
+		 */
+		inline const DealsDayCache &get_day_cache() const {
+			return day_cache;
+		}
+
+		/** \brief Включить упреждающее чтение дней
+		 *
+		 * Методы trade за период, get_deals_days, get_fixed_number_deals и курсор сделок
+		 * будут декодировать следующие дни в рабочих потоках, пока обрабатывается текущий день.
+		 * Каждый поток открывает хранилище заново и видит только сохраненный файл, поэтому дни буфера записи
+		 * и дни, записанные после последнего save, читаются без упреждения. Чтение само хранилище не сохраняет.
+		 * Запись в хранилище (в том числе вытеснение дня из буфера записи и save) останавливает потоки активных чтений,
+		 * и оставшиеся дни читаются без упреждения. Курсор с упреждающим чтением лучше не держать во время записи
+		 * \param threads Количество потоков, 0 отключает упреждающее чтение
+		 * \param depth Максимальное количество заранее декодированных дней, по умолчанию вдвое больше потоков
+		 */
+		inline void set_prefetch(const uint32_t threads, const uint32_t depth = 0) {
+			prefetch_threads = threads;
+			prefetch_depth = depth == 0 ? 2 * threads : depth;
+		}
+
+		inline uint32_t get_prefetch_threads() const {return prefetch_threads;};
+		inline uint32_t get_prefetch_depth() const {return prefetch_depth;};
+
+		/** \brief Очистить кэш декодированных дней
+		 */
+		inline void clear_day_cache() {
+			day_cache.clear();
+			day_cache.clear_stats();
+		}
+
+		/** \brief Пересчитать итоги всех торговых дней
+		 *
+		 * Нужен для хранилищ, записанных без итогов дней. Пока у дня нет итогов,
+		 * винрейт по нему считается по сделкам
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int rebuild_summaries() {
+			if(!iSummaryStorage) return NO_DATA_ACCESS;
+			int err = flush_write_deals();
+			if(err != OK) return err;
+			const DealsCalendar &days_calendar = get_calendar();
+			if(days_calendar.empty()) return NO_DATA_ACCESS;
+			std::vector<Deal> list_deals;
+			for(DealsCalendar::const_iterator it = days_calendar.begin(); it != days_calendar.end(); ++it) {
+				/* читаем без кэша, чтобы не вытеснять из него нужные дни */
+				if(read_deals<STORAGE_TYPE>(iStorage, list_deals, *it) != OK) list_deals.clear();
+				err = write_summary(list_deals, *it);
+				if(err != OK) return err;
 			}
+			iSummaryStorage->save();
 			return OK;
 		}
 
+		/** \brief Построить каталог символов заново по всем дням хранилища
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int rebuild_symbol_catalog() {
+			int err = flush_write_deals();
+			if(err != OK) return err;
+			symbol_catalog.clear();
+			is_symbol_catalog = true;
+			const DealsCalendar &days_calendar = get_calendar();
+			std::vector<Deal> list_deals;
+			for(DealsCalendar::const_iterator it = days_calendar.begin(); it != days_calendar.end(); ++it) {
+				if(read_deals<STORAGE_TYPE>(
+					iStorage,
+					list_deals,
+					*it,
+					ColumnDeals::COLUMN_NAME | ColumnDeals::COLUMN_SYMBOL) != OK) continue;
+				symbol_catalog.add_day(list_deals, *it);
+			}
+			return OK;
+		}
+
+		/** \brief Получить каталог символов
+		 *
+		 * Каталог содержит первый и последний день и количество сделок каждого символа
+		 * \return Каталог символов
+		 */
+		inline const SymbolCatalog &get_symbol_catalog() {
+			prepare_symbol_catalog();
+			return symbol_catalog;
+		}
+
+		/** \brief Включить или отключить журнал сделок
+		 *
+		 * Журнал (файл <путь>.journal) хранит добавленные, но еще не сохраненные сделки
+		 * и позволяет восстановить их при следующем открытии хранилища после аварийного завершения программы.
+		 * По умолчанию журнал отключен. При включении в журнал записываются сделки, уже находящиеся в буфере записи.
+		 * Хранилище, отображенное в память, журнала не имеет
+		 * \param value Флаг записи сделок в журнал
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		int set_journal(const bool value) {
+			const bool is_enabled = value && !std::is_same<STORAGE_TYPE, MappedDealsStorage>::value;
+			if(is_enabled && !is_journal) {
+				/* сделки журнала прошлого сеанса из вытесненных дней должны попасть на диск до замены журнала */
+				if(journal.size() > 0) {
+					int err = save_storage();
+					if(err != OK) return err;
+				}
+				std::vector<Deal> list_deals;
+				write_cache.get_deals(list_deals);
+				int err = journal.reset(list_deals);
+				if(err != OK) return err;
+			}
+			is_journal = is_enabled;
+			return OK;
+		}
+
+		inline bool get_journal() const {return is_journal;};
+
+		/** \brief Установить политику сброса журнала на диск
+		 *
+		 * Записи журнала сразу передаются ОС, поэтому переживают аварийное завершение программы.
+		 * Чтобы записи пережили отключение питания, журнал сбрасывается на диск
+		 * \param records Количество записей между сбросами на диск. Значение 0 - сброс только методом sync_journal
+		 */
+		inline void set_journal_sync(const uint32_t records) {
+			journal.set_sync_records(records);
+		}
+
+		/** \brief Сбросить журнал сделок на диск
+		 * \return Вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+		 */
+		inline int sync_journal() {
+			return journal.sync();
+		}
+
         /** \brief Очистить статистику за указанную дату
          *
          * \param timestamp_date Дата статистки сделок
          * \return Код ошибки
          */
 		int clear_deals(const xtime::timestamp_t timestamp_date) {
-            if(!check_timestamp(date_timestamp)) return OK;
+            if(!check_timestamp(timestamp_date)) return OK;
+            /* записанные в хранилище сделки из журнала не должны вернуться после очистки дня */
+            if(journal.size() > 0) {
+                int err = save_storage();
+                if(err == OK) {
+                    std::vector<Deal> list_deals;
+                    write_cache.get_deals(list_deals);
+                    err = journal.reset(list_deals);
+                }
+                if(err != OK) return err;
+            }
+            /* записанные сделки дня в буфере записи больше не действительны */
+            DealsWriteDay *write_day = write_cache.find(xtime::get_first_timestamp_day(timestamp_date));
+            if(write_day != NULL) write_day->reset();
+            std::vector<Deal> old_deals;
+            if(is_symbol_catalog) read_deals<STORAGE_TYPE>(iStorage, old_deals, timestamp_date);
             std::vector<Deal> temp;
-            return write_deals<STORAGE_TYPE>(temp, timestamp_date);
+            day_cache.invalidate(xtime::get_first_timestamp_day(timestamp_date));
+            stop_readers();
+            unsaved_days.insert(xtime::get_first_timestamp_day(timestamp_date));
+            int err = write_deals<STORAGE_TYPE>(temp, timestamp_date);
+            if(err != OK) return err;
+            snapshot_days.insert(xtime::get_first_timestamp_day(timestamp_date));
+            update_symbol_catalog(old_deals, temp, timestamp_date);
+            return write_summary(temp, timestamp_date);
 		}
 
         /** \brief Добавить сделку
@@ -1264,25 +3017,13 @@ namespace easy_bo {
 
         /** \brief Получить список уникальных символов
          *
-         * Данный метод поможет определить список используемых в статистике сделок символов (валютных пар)
+         * Данный метод поможет определить список используемых в статистике сделок символов (валютных пар).
+         * Список берется из каталога символов, сделки не читаются
          * \return Список используемых в статистике сделок символов (валютных пар)
          */
         std::list<std::string> get_list_unique_symbols() {
-            xtime::timestamp_t min_timestamp = 0, max_timestamp = 0;
-            int err = get_min_max_timestamp(min_timestamp, max_timestamp);
-            if(err != easy_bo::OK) return std::list<std::string>();
-            std::list<std::string> symbol_list;
-            xtime::for_days(min_timestamp, max_timestamp, [&](const xtime::timestamp_t &t){
-                std::vector<Deal> list_deals;
-                int err = get_deals(list_deals, t);
-                if(err != easy_bo::OK) return;
-                std::for_each(list_deals.begin(), list_deals.end(), [&](const Deal &d) {
-                    symbol_list.push_back(d.get_name());
-                });
-            });
-            symbol_list.sort();
-            symbol_list.unique();
-            return symbol_list;
+            if(!prepare_symbol_catalog()) return std::list<std::string>();
+            return symbol_catalog.get_list_names();
         }
 
         /** \brief Получить количество символов
@@ -1297,26 +3038,13 @@ namespace easy_bo {
         /** \brief Получить массив индексов символов
          *
          * Данный метод поможет определить список используемых в статистике сделок индексы символов (валютных пар).
-         * Метод фильтрует массив сделок
+         * Список берется из каталога символов, сделки не читаются
          * \return Упорядоченный список используемых в статистике сделок индексов символов (валютных пар)
          */
         template<class T>
         std::list<T> get_list_index_symbols() {
-            xtime::timestamp_t min_timestamp = 0, max_timestamp = 0;
-            int err = get_min_max_timestamp(min_timestamp, max_timestamp);
-            if(err != easy_bo::OK) return std::list<T>();
-            std::list<T> symbol_list;
-            xtime::for_days(min_timestamp, max_timestamp, [&](const xtime::timestamp_t &t){
-                std::vector<Deal> list_deals;
-                int err = get_deals(list_deals, t);
-                if(err != easy_bo::OK) return;
-                std::for_each(list_deals.begin(), list_deals.end(), [&](const Deal &d) {
-                    symbol_list.push_back(d.symbol);
-                });
-            });
-            symbol_list.sort();
-            symbol_list.unique();
-            return symbol_list;
+            if(!prepare_symbol_catalog()) return std::list<T>();
+            return symbol_catalog.template get_list_indexes<T>();
         }
 
         /** \brief Получить максимальный индекс символа
@@ -1335,6 +3063,9 @@ namespace easy_bo {
 
 	typedef DealsDataStoreTemplate<> DealsDataStore;    /**< Хранилище сделок с использованием JSON */
 	typedef DealsDataStoreTemplate<ArrayDealsStorage> FastDealsDataStore;   /**< Хранилище строк с использованием бинарных данных */
+	typedef DealsDataStoreTemplate<ColumnDealsStorage> ColumnDealsDataStore;    /**< Хранилище сделок с использованием бинарных данных по колонкам */
+	typedef DealsDataStoreTemplate<MappedDealsStorage> MappedDealsDataStore;    /**< Хранилище сделок, отображенное в память только для чтения */
+	typedef DealsDataStoreTemplate<CompactDealsStorage> CompactDealsDataStore;  /**< Хранилище компактных сделок со словарем символов */
 }
 
 #endif // EASY_BO_STANDARD_TESTER_HPP_INCLUDED
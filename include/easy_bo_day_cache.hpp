@@ -0,0 +1,182 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DAY_CACHE_HPP_INCLUDED
+#define EASY_BO_DAY_CACHE_HPP_INCLUDED
+
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <list>
+#include <map>
+
+namespace easy_bo {
+
+    /** \brief Класс кэша декодированных торговых дней
+     *
+     * Хранит отсортированные по времени массивы сделок последних прочитанных дней.
+     * Объем кэша ограничен в байтах, при переполнении вытесняются дни,
+     * к которым дольше всего не обращались.
+     * Для каждого дня запоминается набор декодированных колонок (см. ColumnDeals),
+     * поэтому запрос большего набора колонок считается промахом.
+     */
+    class DealsDayCache {
+    public:
+        static const size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;   /**< Объем кэша по умолчанию */
+
+    private:
+        /** \brief Запись кэша
+         */
+        class Entry {
+        public:
+            xtime::timestamp_t timestamp = 0;   /**< Метка времени начала дня */
+            uint32_t columns = 0;               /**< Набор декодированных колонок */
+            std::vector<OneDealStruct> deals;   /**< Сделки дня */
+        };
+
+        std::list<Entry> list_entries;  /**< Записи, в начале списка последние использованные */
+        std::map<xtime::timestamp_t, std::list<Entry>::iterator> entries_index;
+        size_t max_bytes = DEFAULT_MAX_BYTES;
+        size_t used_bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        static inline size_t get_entry_bytes(const Entry &entry) {
+            return sizeof(Entry) + entry.deals.size() * sizeof(OneDealStruct);
+        }
+
+        void erase(std::map<xtime::timestamp_t, std::list<Entry>::iterator>::iterator it) {
+            used_bytes -= get_entry_bytes(*it->second);
+            list_entries.erase(it->second);
+            entries_index.erase(it);
+        }
+
+        /** \brief Вытеснить старые записи, пока объем кэша превышает лимит
+         */
+        void shrink() {
+            while(used_bytes > max_bytes && !list_entries.empty()) {
+                erase(entries_index.find(list_entries.back().timestamp));
+            }
+        }
+
+    public:
+        DealsDayCache() {};
+
+        /** \brief Установить максимальный объем кэша
+         * \param bytes Объем в байтах. Значение 0 отключает кэш
+         */
+        void set_max_bytes(const size_t bytes) {
+            max_bytes = bytes;
+            shrink();
+        }
+
+        inline size_t get_max_bytes() const {return max_bytes;};
+        inline size_t get_used_bytes() const {return used_bytes;};
+        inline size_t get_amount_days() const {return list_entries.size();};
+        inline uint64_t get_hits() const {return hits;};
+        inline uint64_t get_misses() const {return misses;};
+
+        /** \brief Получить сделки дня из кэша
+         * \param list_deals Массив сделок
+         * \param timestamp Метка времени начала дня
+         * \param columns Требуемый набор колонок
+         * \return Вернет true, если день есть в кэше и содержит все требуемые колонки
+         */
+        bool get(
+                std::vector<OneDealStruct> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t columns) {
+            auto it = entries_index.find(timestamp);
+            if(it == entries_index.end() || (it->second->columns & columns) != columns) {
+                ++misses;
+                return false;
+            }
+            ++hits;
+            list_entries.splice(list_entries.begin(), list_entries, it->second);
+            list_deals = it->second->deals;
+            return true;
+        }
+
+        /** \brief Проверить наличие дня в кэше
+         *
+         * В отличие от get не меняет порядок вытеснения и счетчики
+         * \param timestamp Метка времени начала дня
+         * \param columns Требуемый набор колонок
+         * \return Вернет true, если день есть в кэше и содержит все требуемые колонки
+         */
+        bool check(const xtime::timestamp_t timestamp, const uint32_t columns) const {
+            auto it = entries_index.find(timestamp);
+            return it != entries_index.end() && (it->second->columns & columns) == columns;
+        }
+
+        /** \brief Поместить сделки дня в кэш
+         * \param list_deals Отсортированный по времени массив сделок
+         * \param timestamp Метка времени начала дня
+         * \param columns Набор декодированных колонок
+         */
+        void put(
+                const std::vector<OneDealStruct> &list_deals,
+                const xtime::timestamp_t timestamp,
+                const uint32_t columns) {
+            if(max_bytes == 0) return;
+            invalidate(timestamp);
+            Entry entry;
+            entry.timestamp = timestamp;
+            entry.columns = columns;
+            entry.deals = list_deals;
+            const size_t bytes = get_entry_bytes(entry);
+            if(bytes > max_bytes) return;
+            list_entries.push_front(Entry());
+            list_entries.front().timestamp = timestamp;
+            list_entries.front().columns = columns;
+            list_entries.front().deals.swap(entry.deals);
+            entries_index[timestamp] = list_entries.begin();
+            used_bytes += bytes;
+            shrink();
+        }
+
+        /** \brief Удалить день из кэша
+         * \param timestamp Метка времени начала дня
+         */
+        void invalidate(const xtime::timestamp_t timestamp) {
+            auto it = entries_index.find(timestamp);
+            if(it != entries_index.end()) erase(it);
+        }
+
+        /** \brief Очистить кэш
+         */
+        void clear() {
+            list_entries.clear();
+            entries_index.clear();
+            used_bytes = 0;
+        }
+
+        /** \brief Сбросить счетчики попаданий и промахов
+         */
+        void clear_stats() {
+            hits = 0;
+            misses = 0;
+        }
+    };
+};
+
+#endif // EASY_BO_DAY_CACHE_HPP_INCLUDED
@@ -0,0 +1,255 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DAY_SUMMARY_HPP_INCLUDED
+#define EASY_BO_DAY_SUMMARY_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+namespace easy_bo {
+
+    /** \brief Класс итогов торгового дня
+     *
+     * Хранит количество удачных и прочих сделок дня, сгруппированных по минуте дня,
+     * имени и индексу символа, группе и направлению сделки.
+     * По итогам можно посчитать винрейт с фильтром по символу и минутам дня без декодирования сделок.
+     * Также хранится максимальное время окончания сделок дня, чтобы узнать,
+     * выходят ли сделки дня за указанную метку времени.
+     */
+    class DaySummary {
+    private:
+        enum {
+            FORMAT_VERSION = 1,
+        };
+
+        /** \brief Заголовок итогов дня
+         */
+        struct Header {
+            uint32_t version;               /**< Версия формата */
+            uint32_t amount_names;          /**< Количество имен символов */
+            uint32_t amount_records;        /**< Количество записей */
+            uint32_t amount_deals;          /**< Количество сделок дня */
+            uint64_t max_end_timestamp;     /**< Максимальное время окончания сделок */
+        };
+
+        /** \brief Запись итогов
+         */
+        struct Record {
+            uint16_t minute_day;    /**< Минута дня */
+            uint16_t name_index;    /**< Индекс имени символа в итогах дня */
+            uint8_t symbol;         /**< Индекс символа */
+            uint8_t group;          /**< Группа сделок */
+            int8_t direction;       /**< Направление ставки */
+            uint8_t reserved;       /**< Не используется, обнулен */
+            uint32_t wins;          /**< Количество удачных сделок */
+            uint32_t losses;        /**< Количество остальных сделок */
+        };
+
+        std::string buffer;         /**< Данные итогов: заголовок, имена символов, записи */
+
+        inline const Header *get_header() const {
+            return (const Header*)buffer.data();
+        }
+
+        inline const int8_t *get_names() const {
+            return (const int8_t*)(buffer.data() + sizeof(Header));
+        }
+
+        inline const Record *get_records() const {
+            return (const Record*)(buffer.data() + sizeof(Header) + get_header()->amount_names * NAME_SIZE);
+        }
+
+    public:
+        DaySummary() {};
+
+        /* данный код не изменять! он должен остаться без изменений, т.к. нужен для
+         * работы с хранилищем данных.
+         */
+        virtual DaySummary & operator = (const DaySummary &day_summary) {
+            if(this != &day_summary) buffer = day_summary.buffer;
+            return *this;
+        }
+
+        DaySummary(const DaySummary &day_summary) : buffer(day_summary.buffer) {};
+
+        virtual bool empty() {
+            return buffer.empty();
+        }
+
+        virtual void assign(const char* s, size_t n) {
+            buffer.assign(s, n);
+        }
+
+        virtual size_t size() const {
+            return buffer.size();
+        }
+
+        virtual const char* data() const noexcept {
+            return buffer.data();
+        }
+
+        /* дальше пользовательские методы/конструкторы */
+
+        /** \brief Проверить данные итогов
+         * \return Вернет true, если данные корректны
+         */
+        bool is_valid() const {
+            if(buffer.size() < sizeof(Header)) return false;
+            const Header *header = get_header();
+            if(header->version != FORMAT_VERSION) return false;
+            return buffer.size() == sizeof(Header) +
+                (size_t)header->amount_names * NAME_SIZE +
+                (size_t)header->amount_records * sizeof(Record);
+        }
+
+        /** \brief Получить количество сделок дня
+         * \return Количество сделок
+         */
+        inline uint32_t get_amount_deals() const {
+            return get_header()->amount_deals;
+        }
+
+        /** \brief Получить максимальное время окончания сделок дня
+         * \return Метка времени окончания самой поздней сделки
+         */
+        inline xtime::timestamp_t get_max_end_timestamp() const {
+            return get_header()->max_end_timestamp;
+        }
+
+        /** \brief Посчитать итоги по сделкам дня
+         * \param deals Массив сделок дня
+         */
+        void set_vector(const std::vector<OneDealStruct> &deals) {
+            /* ключ упорядочивает записи по минуте дня */
+            std::map<uint64_t, Record> records;
+            std::vector<std::string> names;
+            std::map<std::string, uint16_t> names_index;
+            Header header;
+            header.version = FORMAT_VERSION;
+            header.amount_deals = deals.size();
+            header.max_end_timestamp = 0;
+            for(size_t i = 0; i < deals.size(); ++i) {
+                const OneDealStruct &deal = deals[i];
+                const std::string name((const char*)deal.name, NAME_SIZE);
+                auto it_name = names_index.find(name);
+                uint16_t name_index = 0;
+                if(it_name == names_index.end()) {
+                    name_index = names.size();
+                    names_index[name] = name_index;
+                    names.push_back(name);
+                } else {
+                    name_index = it_name->second;
+                }
+                const uint16_t minute_day = xtime::get_minute_day(deal.timestamp);
+                const uint64_t key =
+                    ((uint64_t)minute_day << 40) |
+                    ((uint64_t)name_index << 24) |
+                    ((uint64_t)deal.symbol << 16) |
+                    ((uint64_t)deal.group << 8) |
+                    (uint8_t)deal.direction;
+                auto it = records.find(key);
+                if(it == records.end()) {
+                    Record record;
+                    record.minute_day = minute_day;
+                    record.name_index = name_index;
+                    record.symbol = deal.symbol;
+                    record.group = deal.group;
+                    record.direction = deal.direction;
+                    record.reserved = 0;
+                    record.wins = 0;
+                    record.losses = 0;
+                    it = records.insert(std::make_pair(key, record)).first;
+                }
+                /* так же, как при расчете винрейта по сделкам, все неудачные сделки считаются убыточными */
+                if(deal.result == EASY_BO_WIN) ++it->second.wins;
+                else ++it->second.losses;
+                header.max_end_timestamp = std::max(
+                    header.max_end_timestamp,
+                    (uint64_t)(deal.timestamp + deal.duration));
+            }
+            header.amount_names = names.size();
+            header.amount_records = records.size();
+
+            buffer.clear();
+            buffer.reserve(sizeof(Header) + names.size() * NAME_SIZE + records.size() * sizeof(Record));
+            buffer.append((const char*)&header, sizeof(Header));
+            for(size_t n = 0; n < names.size(); ++n) {
+                buffer.append(names[n]);
+            }
+            for(auto it = records.begin(); it != records.end(); ++it) {
+                buffer.append((const char*)&it->second, sizeof(Record));
+            }
+        }
+
+        /** \brief Посчитать сделки по итогам дня
+         * \param wins Количество удачных сделок, будет увеличено
+         * \param losses Количество остальных сделок, будет увеличено
+         * \param start_minute_day Начальная минута дня (включительно)
+         * \param stop_minute_day Конечная минута дня (не включительно)
+         * \param symbol_index Индекс символа или -1, если фильтр не нужен
+         * \param symbol_name Буфер имени символа размером NAME_SIZE или nullptr, если фильтр не нужен
+         */
+        void count_deals(
+                uint32_t &wins,
+                uint32_t &losses,
+                const uint32_t start_minute_day,
+                const uint32_t stop_minute_day,
+                const int32_t symbol_index = -1,
+                const int8_t *symbol_name = nullptr) const {
+            const Header *header = get_header();
+            int32_t name_index = -1;
+            if(symbol_name != nullptr) {
+                const int8_t *names = get_names();
+                for(uint32_t n = 0; n < header->amount_names; ++n) {
+                    if(std::memcmp(names + n * NAME_SIZE, symbol_name, NAME_SIZE) != 0) continue;
+                    name_index = n;
+                    break;
+                }
+                if(name_index < 0) return;
+            }
+            const Record *records = get_records();
+            const Record *records_end = records + header->amount_records;
+            const Record *it = std::lower_bound(records, records_end, start_minute_day,
+                [](const Record &record, const uint32_t minute_day) {
+                    return record.minute_day < minute_day;
+                });
+            for(; it != records_end && it->minute_day < stop_minute_day; ++it) {
+                if(symbol_index >= 0 && it->symbol != symbol_index) continue;
+                if(name_index >= 0 && it->name_index != name_index) continue;
+                wins += it->wins;
+                losses += it->losses;
+            }
+        }
+    };
+
+    typedef xquotes_daily_data_storage::
+        DailyDataStorage<DaySummary> DaySummaryStorage; /**< Хранилище итогов торговых дней */
+};
+
+#endif // EASY_BO_DAY_SUMMARY_HPP_INCLUDED
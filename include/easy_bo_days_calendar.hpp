@@ -0,0 +1,156 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DAYS_CALENDAR_HPP_INCLUDED
+#define EASY_BO_DAYS_CALENDAR_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "xtime.hpp"
+#include <vector>
+#include <algorithm>
+
+namespace easy_bo {
+
+    /** \brief Класс календаря торговых дней хранилища
+     *
+     * Хранит отсортированный по возрастанию список дней, которые есть в хранилище.
+     * Запросы по датам проходят только по этим дням, не проверяя каждый календарный день
+     * между ними (выходные, годы без данных)
+     */
+    class DealsCalendar {
+    public:
+        typedef std::vector<xtime::timestamp_t>::const_iterator const_iterator;
+
+    private:
+        std::vector<xtime::timestamp_t> list_days;  /**< Метки времени начала дней по возрастанию */
+        bool is_built = false;
+
+    public:
+        DealsCalendar() {};
+
+        /** \brief Сбросить календарь
+         *
+         * После сброса календарь нужно построить заново (см. set_days)
+         */
+        inline void clear() {
+            list_days.clear();
+            is_built = false;
+        }
+
+        inline bool built() const {return is_built;};
+
+        /** \brief Установить дни хранилища
+         * \param days Метки времени дней, порядок не важен
+         */
+        void set_days(const std::vector<xtime::timestamp_t> &days) {
+            list_days.resize(days.size());
+            for(size_t i = 0; i < days.size(); ++i) {
+                list_days[i] = xtime::get_first_timestamp_day(days[i]);
+            }
+            std::sort(list_days.begin(), list_days.end());
+            list_days.erase(std::unique(list_days.begin(), list_days.end()), list_days.end());
+            is_built = true;
+        }
+
+        /** \brief Добавить день
+         *
+         * Пока календарь не построен, дни не добавляются
+         * \param timestamp Метка времени дня
+         */
+        void add_day(const xtime::timestamp_t timestamp) {
+            if(!is_built) return;
+            const xtime::timestamp_t day = xtime::get_first_timestamp_day(timestamp);
+            /* дни обычно дописываются в конец */
+            if(list_days.empty() || list_days.back() < day) {
+                list_days.push_back(day);
+                return;
+            }
+            auto it = std::lower_bound(list_days.begin(), list_days.end(), day);
+            if(it == list_days.end() || *it != day) list_days.insert(it, day);
+        }
+
+        inline const_iterator begin() const {return list_days.begin();};
+        inline const_iterator end() const {return list_days.end();};
+        inline size_t size() const {return list_days.size();};
+        inline bool empty() const {return list_days.empty();};
+        inline const std::vector<xtime::timestamp_t> &get_days() const {return list_days;};
+
+        /** \brief Найти первый день, не раньше указанной метки времени
+         * \param timestamp Метка времени
+         * \return Итератор дня или end()
+         */
+        inline const_iterator lower_bound(const xtime::timestamp_t timestamp) const {
+            return std::lower_bound(list_days.begin(), list_days.end(), xtime::get_first_timestamp_day(timestamp));
+        }
+
+        /** \brief Найти первый день после дня указанной метки времени
+         * \param timestamp Метка времени
+         * \return Итератор дня или end()
+         */
+        inline const_iterator upper_bound(const xtime::timestamp_t timestamp) const {
+            return std::upper_bound(list_days.begin(), list_days.end(), xtime::get_first_timestamp_day(timestamp));
+        }
+
+        /** \brief Проверить наличие дня
+         * \param timestamp Метка времени
+         * \return Вернет true, если день есть в календаре
+         */
+        inline bool check_day(const xtime::timestamp_t timestamp) const {
+            const_iterator it = lower_bound(timestamp);
+            return it != list_days.end() && *it == xtime::get_first_timestamp_day(timestamp);
+        }
+
+        /** \brief Получить дни в диапазоне дат
+         * \param days Метки времени дней по возрастанию
+         * \param start_timestamp Начальная дата, включительно
+         * \param stop_timestamp Конечная дата, включительно
+         */
+        void get_days(
+                std::vector<xtime::timestamp_t> &days,
+                const xtime::timestamp_t start_timestamp,
+                const xtime::timestamp_t stop_timestamp) const {
+            days.clear();
+            if(stop_timestamp < start_timestamp) return;
+            days.assign(lower_bound(start_timestamp), upper_bound(stop_timestamp));
+        }
+
+        /** \brief Получить последние дни перед датой
+         * \param days Метки времени дней, от последнего к первому
+         * \param stop_timestamp Дата, сам день этой даты не учитывается
+         * \param amount Максимальное количество дней. Значение 0 - все дни
+         */
+        void get_days_before(
+                std::vector<xtime::timestamp_t> &days,
+                const xtime::timestamp_t stop_timestamp,
+                const size_t amount = 0) const {
+            days.clear();
+            const_iterator it = lower_bound(stop_timestamp);
+            while(it != list_days.begin() && (amount == 0 || days.size() < amount)) {
+                --it;
+                days.push_back(*it);
+            }
+        }
+    };
+};
+
+#endif // EASY_BO_DAYS_CALENDAR_HPP_INCLUDED
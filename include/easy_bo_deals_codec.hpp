@@ -0,0 +1,333 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DEALS_CODEC_HPP_INCLUDED
+#define EASY_BO_DEALS_CODEC_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "zstd.h"
+#include <string>
+#include <fstream>
+#include <atomic>
+
+namespace easy_bo {
+
+    /** \brief Настройки сжатия торговых дней хранилища
+     *
+     * Настройки хранятся в файле <путь к хранилищу>.codec и задаются только для нового хранилища
+     */
+    class DealsCodecConfig {
+    public:
+        static const uint32_t FILE_MAGIC = 0x435A4245;  /**< Сигнатура файла "EBZC" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+
+        /// Способы сжатия
+        enum {
+            CODEC_NONE = 0,         /**< Без сжатия (как записывает само хранилище дней) */
+            CODEC_ZSTD = 1,         /**< zstd */
+            CODEC_ZSTD_LONG = 2,    /**< zstd с поиском дальних совпадений */
+        };
+
+        static const int MIN_LEVEL = 1;     /**< Минимальный уровень сжатия zstd */
+        static const int MAX_LEVEL = 19;    /**< Максимальный уровень сжатия zstd */
+
+        uint32_t codec = CODEC_NONE;        /**< Способ сжатия */
+        int level = 0;                      /**< Уровень сжатия zstd */
+
+        DealsCodecConfig() {};
+
+        DealsCodecConfig(const uint32_t user_codec, const int user_level = 3) :
+            codec(user_codec), level(user_codec == CODEC_NONE ? 0 : user_level) {};
+
+        inline bool is_enabled() const {return codec != CODEC_NONE;};
+
+        /** \brief Проверить настройки
+         * \return Вернет true, если способ сжатия известен, а уровень сжатия допустим
+         */
+        inline bool check() const {
+            if(codec == CODEC_NONE) return level == 0;
+            if(codec != CODEC_ZSTD && codec != CODEC_ZSTD_LONG) return false;
+            return level >= MIN_LEVEL && level <= MAX_LEVEL;
+        }
+
+        /** \brief Получить название настроек
+         * \return Название, например zstd-19 или zstd-long-19
+         */
+        std::string get_name() const {
+            switch(codec) {
+            case CODEC_NONE:
+                return "none";
+            case CODEC_ZSTD:
+                return "zstd-" + std::to_string(level);
+            case CODEC_ZSTD_LONG:
+                return "zstd-long-" + std::to_string(level);
+            };
+            return "unknown";
+        }
+
+        /** \brief Получить путь к файлу настроек
+         * \param store_path Путь к хранилищу
+         * \return Путь к файлу настроек
+         */
+        static inline std::string get_path(const std::string &store_path) {
+            return store_path + ".codec";
+        }
+
+        /** \brief Загрузить настройки хранилища
+         * \param store_path Путь к хранилищу
+         * \return Вернет 0 в случае успеха, NO_DATA_ACCESS если настроек нет
+         */
+        int load(const std::string &store_path) {
+            *this = DealsCodecConfig();
+            std::ifstream file(get_path(store_path), std::ios::binary);
+            if(!file) return NO_DATA_ACCESS;
+            int32_t header[4] = {};
+            if(!file.read((char*)header, sizeof(header))) return PARSER_ERROR;
+            if((uint32_t)header[0] != FILE_MAGIC || (uint32_t)header[1] != FILE_VERSION) return PARSER_ERROR;
+            DealsCodecConfig config;
+            config.codec = header[2];
+            config.level = header[3];
+            if(!config.check()) return PARSER_ERROR;
+            *this = config;
+            return OK;
+        }
+
+        /** \brief Записать настройки для нового хранилища
+         *
+         * Настройки можно записать только до создания файла хранилища
+         * \param store_path Путь к хранилищу
+         * \return Вернет 0 в случае успеха, INVALID_PARAMETER если хранилище уже существует
+         */
+        int save(const std::string &store_path) const {
+            if(!check()) return INVALID_PARAMETER;
+            {
+                std::ifstream store_file(store_path, std::ios::binary);
+                if(store_file) return INVALID_PARAMETER;
+            }
+            std::ofstream file(get_path(store_path), std::ios::binary | std::ios::trunc);
+            if(!file) return NO_DATA_ACCESS;
+            const int32_t header[4] = {(int32_t)FILE_MAGIC, (int32_t)FILE_VERSION, (int32_t)codec, level};
+            file.write((const char*)header, sizeof(header));
+            return file ? OK : NO_DATA_ACCESS;
+        }
+    };
+
+    /** \brief Контекст распаковки торговых дней
+     *
+     * Хранит ZSTD_DCtx между вызовами DealsCodec::decode, чтобы не выделять его на каждый день.
+     * Контекст используется только одним потоком
+     */
+    class DealsDecodeContext {
+    private:
+        ZSTD_DCtx *dctx = NULL;
+        uint64_t codec_id = 0;  /**< Номер сжатия, словарь которого подключен к контексту */
+
+        friend class DealsCodec;
+
+    public:
+        DealsDecodeContext() {};
+
+        DealsDecodeContext(const DealsDecodeContext&) = delete;
+        DealsDecodeContext &operator = (const DealsDecodeContext&) = delete;
+
+        ~DealsDecodeContext() {
+            if(dctx != NULL) ZSTD_freeDCtx(dctx);
+        }
+    };
+
+    /** \brief Класс сжатия торговых дней
+     *
+     * Сжимает данные дня перед записью в хранилище дней, поэтому хранилище получает
+     * уже сжатые данные и словарь ему не передается (см. DealsDataStoreTemplate).
+     * Сжатие выполняется только из потока записи хранилища, распаковка потокобезопасна
+     */
+    class DealsCodec {
+    private:
+        DealsCodecConfig config;
+        ZSTD_CCtx *cctx = NULL;
+        ZSTD_DDict *ddict = NULL;
+        uint64_t codec_id = 0;      /**< Номер сжатия, уникален для каждого вызова init */
+
+        void close() {
+            if(cctx != NULL) ZSTD_freeCCtx(cctx);
+            if(ddict != NULL) ZSTD_freeDDict(ddict);
+            cctx = NULL;
+            ddict = NULL;
+        }
+
+        static uint64_t get_next_id() {
+            static std::atomic<uint64_t> last_id(0);
+            return ++last_id;
+        }
+
+    public:
+        static const size_t MAX_DECODE_RATIO = 32768;   /**< Предельная степень сжатия zstd (RLE-блок: 4 байта на 128 КБ) */
+        static const size_t MAX_DAY_SIZE = 1UL << 30;   /**< Предельный размер данных дня */
+
+        DealsCodec() {};
+
+        DealsCodec(const DealsCodecConfig &user_config, const std::string &dictionary) {
+            init(user_config, dictionary);
+        }
+
+        DealsCodec(const DealsCodec&) = delete;
+        DealsCodec &operator = (const DealsCodec&) = delete;
+
+        ~DealsCodec() {
+            close();
+        }
+
+        /** \brief Инициализировать сжатие
+         * \param user_config Настройки сжатия
+         * \param dictionary Словарь zstd, может быть пустым
+         * \return Вернет 0 в случае успеха
+         */
+        int init(const DealsCodecConfig &user_config, const std::string &dictionary) {
+            close();
+            config = DealsCodecConfig();
+            codec_id = get_next_id();
+            if(!user_config.check()) return INVALID_PARAMETER;
+            if(!user_config.is_enabled()) return OK;
+            cctx = ZSTD_createCCtx();
+            if(cctx == NULL) return UNKNOWN_ERROR;
+            bool is_error =
+                ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, user_config.level)) ||
+                ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1));
+            if(!is_error && user_config.codec == DealsCodecConfig::CODEC_ZSTD_LONG) {
+                is_error = ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1));
+            }
+            if(!is_error && !dictionary.empty()) {
+                is_error = ZSTD_isError(ZSTD_CCtx_loadDictionary(cctx, dictionary.data(), dictionary.size()));
+                if(!is_error) {
+                    ddict = ZSTD_createDDict(dictionary.data(), dictionary.size());
+                    is_error = ddict == NULL;
+                }
+            }
+            if(is_error) {
+                close();
+                return UNKNOWN_ERROR;
+            }
+            config = user_config;
+            return OK;
+        }
+
+        inline bool is_enabled() const {return config.is_enabled();};
+        inline const DealsCodecConfig &get_config() const {return config;};
+
+        /** \brief Сжать данные дня
+         * \param src Данные
+         * \param src_size Размер данных
+         * \param dst Сжатые данные
+         * \return Вернет 0 в случае успеха
+         */
+        int encode(const char *src, const size_t src_size, std::string &dst) {
+            if(!is_enabled()) {
+                dst.assign(src, src_size);
+                return OK;
+            }
+            dst.resize(ZSTD_compressBound(src_size));
+            const size_t size = ZSTD_compress2(cctx, &dst[0], dst.size(), src, src_size);
+            if(ZSTD_isError(size)) {
+                dst.clear();
+                return UNKNOWN_ERROR;
+            }
+            dst.resize(size);
+            return OK;
+        }
+
+        /** \brief Распаковать данные дня
+         *
+         * Размер данных из заголовка кадра ограничен MAX_DAY_SIZE и MAX_DECODE_RATIO,
+         * поврежденный заголовок возвращает ошибку, а не выделяет память
+         * \param src Сжатые данные
+         * \param src_size Размер сжатых данных
+         * \param dst Данные
+         * \param context Контекст распаковки вызывающего потока
+         * \return Вернет 0 в случае успеха
+         */
+        int decode(const char *src, const size_t src_size, std::string &dst, DealsDecodeContext &context) const {
+            if(!is_enabled()) {
+                dst.assign(src, src_size);
+                return OK;
+            }
+            const unsigned long long content_size = ZSTD_getFrameContentSize(src, src_size);
+            if(content_size == ZSTD_CONTENTSIZE_ERROR ||
+                content_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+                content_size > MAX_DAY_SIZE ||
+                content_size > (unsigned long long)src_size * MAX_DECODE_RATIO) {
+                dst.clear();
+                return PARSER_ERROR;
+            }
+            dst.resize(content_size);
+            if(content_size == 0) return OK;
+            if(context.dctx == NULL) {
+                context.dctx = ZSTD_createDCtx();
+                if(context.dctx == NULL) return UNKNOWN_ERROR;
+                context.codec_id = 0;
+            }
+            /* словарь подключается к контексту один раз для каждого сжатия */
+            if(context.codec_id != codec_id) {
+                if(ZSTD_isError(ZSTD_DCtx_refDDict(context.dctx, ddict))) {
+                    dst.clear();
+                    return UNKNOWN_ERROR;
+                }
+                context.codec_id = codec_id;
+            }
+            const size_t size = ZSTD_decompressDCtx(context.dctx, &dst[0], dst.size(), src, src_size);
+            if(ZSTD_isError(size) || size != content_size) {
+                dst.clear();
+                return PARSER_ERROR;
+            }
+            return OK;
+        }
+
+        /** \brief Распаковать данные дня
+         *
+         * Использует контекст распаковки текущего потока
+         * \param src Сжатые данные
+         * \param src_size Размер сжатых данных
+         * \param dst Данные
+         * \return Вернет 0 в случае успеха
+         */
+        int decode(const char *src, const size_t src_size, std::string &dst) const {
+            static thread_local DealsDecodeContext context;
+            return decode(src, src_size, dst, context);
+        }
+    };
+
+    /** \brief Результат замера сжатия торговых дней
+     */
+    class DealsCodecBenchmark {
+    public:
+        DealsCodecConfig config;    /**< Настройки сжатия */
+        uint32_t days = 0;          /**< Количество дней в выборке */
+        uint64_t raw_bytes = 0;     /**< Размер несжатых данных */
+        uint64_t encoded_bytes = 0; /**< Размер сжатых данных */
+        double ratio = 0;           /**< Степень сжатия */
+        double encode_speed = 0;    /**< Скорость сжатия, МБ/с */
+        double decode_speed = 0;    /**< Скорость распаковки, МБ/с */
+        int err = OK;               /**< Код ошибки */
+    };
+};
+
+#endif // EASY_BO_DEALS_CODEC_HPP_INCLUDED
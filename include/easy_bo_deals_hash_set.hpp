@@ -0,0 +1,144 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DEALS_HASH_SET_HPP_INCLUDED
+#define EASY_BO_DEALS_HASH_SET_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <cstring>
+
+namespace easy_bo {
+
+    /** \brief Класс множества отпечатков сделок одного дня
+     *
+     * Хеш-таблица с открытой адресацией для поиска повторов сделок за O(1).
+     * Таблица хранит отпечатки и индексы сделок, а сами сделки остаются у владельца массива.
+     * При совпадении отпечатков сделки сравниваются целиком (OneDealStruct::operator ==),
+     * поэтому коллизия отпечатков не может удалить сделку
+     */
+    class DealsHashSet {
+    private:
+        static const size_t MIN_CAPACITY = 16;
+
+        std::vector<uint64_t> list_fingerprint; /**< Отпечатки сделок, 0 - пустая ячейка */
+        std::vector<uint32_t> list_index;       /**< Индексы сделок */
+        size_t amount = 0;                      /**< Количество сделок в таблице */
+        size_t mask = 0;                        /**< Маска номера ячейки */
+
+        static inline uint64_t mix(uint64_t hash, const uint64_t value) {
+            hash ^= value;
+            hash *= 0xFF51AFD7ED558CCDULL;
+            return hash ^ (hash >> 32);
+        }
+
+        void rehash(const size_t capacity) {
+            std::vector<uint64_t> old_fingerprint(capacity, 0);
+            std::vector<uint32_t> old_index(capacity, 0);
+            old_fingerprint.swap(list_fingerprint);
+            old_index.swap(list_index);
+            mask = capacity - 1;
+            for(size_t i = 0; i < old_fingerprint.size(); ++i) {
+                if(old_fingerprint[i] == 0) continue;
+                size_t slot = old_fingerprint[i] & mask;
+                while(list_fingerprint[slot] != 0) slot = (slot + 1) & mask;
+                list_fingerprint[slot] = old_fingerprint[i];
+                list_index[slot] = old_index[i];
+            }
+        }
+
+    public:
+        DealsHashSet() {};
+
+        /** \brief Получить отпечаток сделки
+         *
+         * Учитывает те же поля, что и OneDealStruct::operator ==
+         * \param deal Сделка
+         * \return Отпечаток сделки, не равен 0
+         */
+        static uint64_t get_fingerprint(const OneDealStruct &deal) {
+            uint64_t name[NAME_SIZE / sizeof(uint64_t)];
+            std::memcpy(name, deal.name, NAME_SIZE);
+            uint64_t hash = mix(0xCBF29CE484222325ULL, (uint64_t)deal.timestamp);
+            hash = mix(hash,
+                ((uint64_t)deal.duration << 32) |
+                ((uint64_t)(uint8_t)deal.direction << 24) |
+                ((uint64_t)(uint8_t)deal.result << 16) |
+                ((uint64_t)deal.group << 8) |
+                (uint64_t)deal.symbol);
+            for(size_t i = 0; i < NAME_SIZE / sizeof(uint64_t); ++i) {
+                hash = mix(hash, name[i]);
+            }
+            hash ^= hash >> 29;
+            return hash == 0 ? 1 : hash;
+        }
+
+        /** \brief Очистить множество
+         */
+        inline void clear() {
+            list_fingerprint.clear();
+            list_index.clear();
+            amount = 0;
+            mask = 0;
+        }
+
+        inline size_t size() const {return amount;};
+        inline bool empty() const {return amount == 0;};
+
+        /** \brief Зарезервировать место
+         * \param capacity Ожидаемое количество сделок
+         */
+        void reserve(const size_t capacity) {
+            size_t size = MIN_CAPACITY;
+            while(size < capacity * 2) size *= 2;
+            if(size > list_fingerprint.size()) rehash(size);
+        }
+
+        /** \brief Добавить сделку
+         * \param deal Сделка
+         * \param index Индекс сделки у владельца массива
+         * \param get_deal Функция, возвращающая сделку по индексу
+         * \return Вернет false, если такая сделка уже есть
+         */
+        template<class GET_DEAL>
+        bool insert(const OneDealStruct &deal, const uint32_t index, const GET_DEAL &get_deal) {
+            /* заполнение таблицы не больше половины */
+            if((amount + 1) * 2 > list_fingerprint.size()) {
+                rehash(list_fingerprint.empty() ? MIN_CAPACITY : list_fingerprint.size() * 2);
+            }
+            const uint64_t fingerprint = get_fingerprint(deal);
+            size_t slot = fingerprint & mask;
+            while(list_fingerprint[slot] != 0) {
+                if(list_fingerprint[slot] == fingerprint && get_deal(list_index[slot]) == deal) return false;
+                slot = (slot + 1) & mask;
+            }
+            list_fingerprint[slot] = fingerprint;
+            list_index[slot] = index;
+            ++amount;
+            return true;
+        }
+    };
+};
+
+#endif // EASY_BO_DEALS_HASH_SET_HPP_INCLUDED
@@ -0,0 +1,354 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DEALS_INGEST_HPP_INCLUDED
+#define EASY_BO_DEALS_INGEST_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+namespace easy_bo {
+
+    /** \brief Класс ограниченной очереди сделок без блокировок
+     *
+     * Очередь для нескольких производителей и одного потребителя.
+     * Каждая ячейка кольцевого буфера хранит номер своей позиции, поэтому
+     * производители занимают позиции одной атомарной операцией и не ждут друг друга.
+     * Размер очереди округляется вверх до степени двойки
+     */
+    class DealsIngestQueue {
+    private:
+        class Cell {
+        public:
+            std::atomic<size_t> sequence;
+            OneDealStruct deal;
+        };
+
+        std::unique_ptr<Cell[]> buffer;
+        size_t mask = 0;
+        /* позиции записи и чтения изменяются разными потоками, разносим их по разным строкам кэша */
+        char padding_0[64];
+        std::atomic<size_t> enqueue_pos;
+        char padding_1[64];
+        std::atomic<size_t> dequeue_pos;
+        char padding_2[64];
+
+    public:
+
+        /** \brief Инициализировать очередь
+         * \param capacity Размер очереди в сделках
+         */
+        DealsIngestQueue(const size_t capacity) : enqueue_pos(0), dequeue_pos(0) {
+            size_t size = 2;
+            while(size < capacity) size <<= 1;
+            buffer = std::unique_ptr<Cell[]>(new Cell[size]);
+            mask = size - 1;
+            for(size_t i = 0; i < size; ++i) {
+                buffer[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        DealsIngestQueue(const DealsIngestQueue&) = delete;
+        DealsIngestQueue &operator = (const DealsIngestQueue&) = delete;
+
+        /** \brief Поместить сделку в очередь
+         *
+         * Метод можно вызывать из любого потока
+         * \param deal Сделка
+         * \return Вернет false, если очередь заполнена
+         */
+        bool push(const OneDealStruct &deal) {
+            size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            Cell *cell = nullptr;
+            while(true) {
+                cell = &buffer[pos & mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+                if(diff == 0) {
+                    if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                } else
+                if(diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            cell->deal = deal;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** \brief Извлечь сделку из очереди
+         *
+         * Метод вызывается только потоком-потребителем
+         * \param deal Сделка
+         * \return Вернет false, если очередь пуста
+         */
+        bool pop(OneDealStruct &deal) {
+            const size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+            Cell *cell = &buffer[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            if((intptr_t)sequence - (intptr_t)(pos + 1) < 0) return false;
+            deal = cell->deal;
+            cell->sequence.store(pos + mask + 1, std::memory_order_release);
+            dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /** \brief Получить примерное количество сделок в очереди
+         * \return Количество сделок
+         */
+        inline size_t size() const {
+            const size_t begin = dequeue_pos.load(std::memory_order_relaxed);
+            const size_t end = enqueue_pos.load(std::memory_order_relaxed);
+            return end > begin ? end - begin : 0;
+        }
+
+        /** \brief Получить количество сделок, помещенных в очередь за все время
+         * \return Количество сделок
+         */
+        inline uint64_t get_amount_pushed() const {
+            return enqueue_pos.load(std::memory_order_relaxed);
+        }
+
+        inline size_t capacity() const {return mask + 1;};
+    };
+
+    /** \brief Класс статистики очереди записи сделок
+     */
+    class DealsIngestQueueStats {
+    public:
+        uint64_t pushed = 0;        /**< Количество сделок, принятых в очередь */
+        uint64_t rejected = 0;      /**< Количество сделок, отклоненных из-за заполненной очереди */
+        uint64_t waits = 0;         /**< Количество ожиданий места в очереди */
+        uint64_t written = 0;       /**< Количество сделок, переданных в хранилище */
+        uint64_t batches = 0;       /**< Количество пакетов, переданных в хранилище */
+        uint64_t errors = 0;        /**< Количество пакетов, записанных с ошибкой */
+        int last_error = OK;        /**< Код последней ошибки записи */
+        size_t depth = 0;           /**< Текущее количество сделок в очереди */
+        size_t max_depth = 0;       /**< Максимальное замеченное количество сделок в очереди */
+    };
+
+    /** \brief Класс фоновой записи сделок в хранилище
+     *
+     * Потоки стратегий помещают сделки в очередь без блокировок, а отдельный поток
+     * забирает их пакетами и передает в хранилище методом add_deals.
+     * Слияние и сжатие дней при вытеснении из буфера записи хранилища выполняются в потоке записи и не задерживают стратегии.
+     * Пока поток записи работает, хранилище нельзя использовать из других потоков
+     */
+    template<class DEALS_STORE>
+    class DealsIngestWriter {
+    public:
+        static const size_t DEFAULT_CAPACITY = 65536;   /**< Размер очереди по умолчанию */
+        static const size_t DEFAULT_BATCH_SIZE = 4096;  /**< Размер пакета по умолчанию */
+
+        /// Поведение при заполненной очереди
+        enum {
+            BACKPRESSURE_WAIT = 0,      ///< Ждать освобождения места в очереди
+            BACKPRESSURE_REJECT = 1,    ///< Отклонить сделку
+        };
+
+    private:
+        DEALS_STORE &store;
+        DealsIngestQueue queue;
+        size_t batch_size = DEFAULT_BATCH_SIZE;
+        int backpressure = BACKPRESSURE_WAIT;
+        std::chrono::microseconds idle_wait;
+        std::thread writer;
+        std::atomic<bool> is_stop;
+        std::atomic<bool> is_accepting;     /**< Флаг приема сделок, установлен пока работает поток записи */
+        std::atomic<uint32_t> producers;    /**< Количество потоков внутри add_deal */
+        std::atomic<uint64_t> rejected;
+        std::atomic<uint64_t> waits;
+        std::atomic<uint64_t> written;
+        std::atomic<uint64_t> batches;
+        std::atomic<uint64_t> errors;
+        std::atomic<int> last_error;
+        std::atomic<size_t> max_depth;
+
+        /** \brief Передать пакет сделок в хранилище
+         */
+        void write_batch(std::vector<OneDealStruct> &batch) {
+            if(batch.empty()) return;
+            const int err = store.add_deals(batch);
+            if(err != OK) {
+                errors.fetch_add(1, std::memory_order_relaxed);
+                last_error.store(err, std::memory_order_relaxed);
+            }
+            written.fetch_add(batch.size(), std::memory_order_relaxed);
+            batches.fetch_add(1, std::memory_order_relaxed);
+            batch.clear();
+        }
+
+        /** \brief Забрать из очереди все доступные сделки
+         * \return Вернет true, если была забрана хотя бы одна сделка
+         */
+        bool drain(std::vector<OneDealStruct> &batch) {
+            const size_t depth = queue.size();
+            if(depth > max_depth.load(std::memory_order_relaxed)) max_depth.store(depth, std::memory_order_relaxed);
+            bool is_data = false;
+            OneDealStruct deal;
+            while(queue.pop(deal)) {
+                is_data = true;
+                batch.push_back(deal);
+                if(batch.size() >= batch_size) write_batch(batch);
+            }
+            write_batch(batch);
+            return is_data;
+        }
+
+        void run() {
+            std::vector<OneDealStruct> batch;
+            batch.reserve(batch_size);
+            while(!is_stop.load(std::memory_order_acquire)) {
+                if(!drain(batch)) std::this_thread::sleep_for(idle_wait);
+            }
+            /* после остановки дописываем все, что успели поместить в очередь */
+            drain(batch);
+        }
+
+    public:
+
+        /** \brief Инициализировать фоновую запись сделок
+         * \param deals_store Хранилище сделок
+         * \param capacity Размер очереди в сделках
+         * \param batch Максимальный размер пакета сделок
+         */
+        DealsIngestWriter(
+                DEALS_STORE &deals_store,
+                const size_t capacity = DEFAULT_CAPACITY,
+                const size_t batch = DEFAULT_BATCH_SIZE) :
+                store(deals_store),
+                queue(capacity),
+                batch_size(std::max(batch, (size_t)1)),
+                idle_wait(1000),
+                is_stop(false),
+                is_accepting(false),
+                producers(0),
+                rejected(0),
+                waits(0),
+                written(0),
+                batches(0),
+                errors(0),
+                last_error(OK),
+                max_depth(0) {
+        }
+
+        DealsIngestWriter(const DealsIngestWriter&) = delete;
+        DealsIngestWriter &operator = (const DealsIngestWriter&) = delete;
+
+        ~DealsIngestWriter() {
+            stop();
+        }
+
+        /** \brief Установить поведение при заполненной очереди
+         * \param value Поведение (BACKPRESSURE_WAIT или BACKPRESSURE_REJECT)
+         */
+        inline void set_backpressure(const int value) {
+            backpressure = value;
+        }
+
+        /** \brief Установить время ожидания потока записи при пустой очереди
+         * \param microseconds Время ожидания в микросекундах
+         */
+        inline void set_idle_wait(const uint32_t microseconds) {
+            idle_wait = std::chrono::microseconds(microseconds);
+        }
+
+        /** \brief Запустить поток записи
+         *
+         * Методы start и stop вызываются из одного управляющего потока
+         */
+        void start() {
+            if(writer.joinable()) return;
+            is_stop.store(false, std::memory_order_release);
+            is_accepting.store(true);
+            writer = std::thread(&DealsIngestWriter::run, this);
+        }
+
+        /** \brief Остановить поток записи
+         *
+         * Метод перестает принимать сделки, дожидается записи всех сделок очереди и сохраняет хранилище
+         * \return Вернет 0 в случае успеха, иначе код последней ошибки
+         */
+        int stop() {
+            if(!writer.joinable()) return last_error.load(std::memory_order_relaxed);
+            is_accepting.store(false);
+            /* сделки, которые уже помещаются в очередь, попадут в последний пакет потока записи */
+            while(producers.load() > 0) std::this_thread::yield();
+            is_stop.store(true, std::memory_order_release);
+            writer.join();
+            const int err = store.save();
+            if(err != OK) last_error.store(err, std::memory_order_relaxed);
+            return last_error.load(std::memory_order_relaxed);
+        }
+
+        /** \brief Добавить сделку
+         *
+         * Метод можно вызывать из любого потока. Сделка, принятая методом, будет записана
+         * \param deal Сделка
+         * \return Вернет false, если сделка отклонена из-за заполненной очереди или остановленного потока записи
+         */
+        bool add_deal(const OneDealStruct &deal) {
+            /* stop не остановит поток записи, пока сделка помещается в очередь */
+            producers.fetch_add(1);
+            bool is_pushed = false;
+            if(is_accepting.load()) {
+                is_pushed = queue.push(deal);
+                if(!is_pushed && backpressure == BACKPRESSURE_WAIT) {
+                    waits.fetch_add(1, std::memory_order_relaxed);
+                    while(!(is_pushed = queue.push(deal))) std::this_thread::yield();
+                }
+            }
+            producers.fetch_sub(1);
+            if(!is_pushed) rejected.fetch_add(1, std::memory_order_relaxed);
+            return is_pushed;
+        }
+
+        /** \brief Получить статистику очереди
+         * \return Статистика очереди
+         */
+        DealsIngestQueueStats get_stats() const {
+            DealsIngestQueueStats stats;
+            stats.pushed = queue.get_amount_pushed();
+            stats.rejected = rejected.load(std::memory_order_relaxed);
+            stats.waits = waits.load(std::memory_order_relaxed);
+            stats.written = written.load(std::memory_order_relaxed);
+            stats.batches = batches.load(std::memory_order_relaxed);
+            stats.errors = errors.load(std::memory_order_relaxed);
+            stats.last_error = last_error.load(std::memory_order_relaxed);
+            stats.depth = queue.size();
+            stats.max_depth = std::max(max_depth.load(std::memory_order_relaxed), stats.depth);
+            return stats;
+        }
+    };
+};
+
+#endif // EASY_BO_DEALS_INGEST_HPP_INCLUDED
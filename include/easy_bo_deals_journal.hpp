@@ -0,0 +1,300 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DEALS_JOURNAL_HPP_INCLUDED
+#define EASY_BO_DEALS_JOURNAL_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace easy_bo {
+
+    /** \brief Класс журнала записи сделок
+     *
+     * Журнал - файл, в конец которого дописывается каждая добавленная сделка.
+     * Записи журнала имеют фиксированный размер и контрольную сумму, поэтому
+     * после аварийного завершения программы недописанная последняя запись отбрасывается.
+     * Журнал хранит сделки, которые еще не сохранены в хранилище, и очищается после сохранения хранилища.
+     */
+    class DealsJournal {
+    public:
+        static const uint32_t FILE_MAGIC = 0x4a534245;  /**< Сигнатура файла "EBSJ" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+        static const size_t HEADER_SIZE = 8;            /**< Размер заголовка файла */
+        static const size_t RECORD_DATA_SIZE = NAME_SIZE + 8 + 4 + 4 + 4;   /**< Размер данных сделки */
+        static const size_t RECORD_SIZE = RECORD_DATA_SIZE + 4;             /**< Размер записи с контрольной суммой */
+
+    private:
+        std::string path;
+        FILE *file = NULL;
+        uint32_t sync_records = 0;      /**< Количество записей между сбросами на диск, 0 - только по вызову sync */
+        uint32_t unsynced_records = 0;
+        size_t amount_records = 0;
+
+        static uint32_t get_checksum(const uint8_t *data, const size_t size) {
+            /* FNV-1a */
+            uint32_t hash = 2166136261UL;
+            for(size_t i = 0; i < size; ++i) {
+                hash ^= data[i];
+                hash *= 16777619UL;
+            }
+            return hash;
+        }
+
+        static void encode_record(const OneDealStruct &deal, uint8_t *record) {
+            uint8_t *ptr = record;
+            std::memcpy(ptr, deal.name, NAME_SIZE); ptr += NAME_SIZE;
+            const uint64_t timestamp = deal.timestamp;
+            std::memcpy(ptr, &timestamp, 8); ptr += 8;
+            std::memcpy(ptr, &deal.duration, 4); ptr += 4;
+            std::memcpy(ptr, &deal.winrate, 4); ptr += 4;
+            ptr[0] = (uint8_t)deal.direction;
+            ptr[1] = (uint8_t)deal.result;
+            ptr[2] = deal.group;
+            ptr[3] = deal.symbol;
+            ptr += 4;
+            const uint32_t checksum = get_checksum(record, RECORD_DATA_SIZE);
+            std::memcpy(ptr, &checksum, 4);
+        }
+
+        static bool decode_record(const uint8_t *record, OneDealStruct &deal) {
+            uint32_t checksum = 0;
+            std::memcpy(&checksum, record + RECORD_DATA_SIZE, 4);
+            if(checksum != get_checksum(record, RECORD_DATA_SIZE)) return false;
+            const uint8_t *ptr = record;
+            std::memcpy(deal.name, ptr, NAME_SIZE); ptr += NAME_SIZE;
+            uint64_t timestamp = 0;
+            std::memcpy(&timestamp, ptr, 8); ptr += 8;
+            deal.timestamp = timestamp;
+            std::memcpy(&deal.duration, ptr, 4); ptr += 4;
+            std::memcpy(&deal.winrate, ptr, 4); ptr += 4;
+            deal.direction = (int8_t)ptr[0];
+            deal.result = (int8_t)ptr[1];
+            deal.group = ptr[2];
+            deal.symbol = ptr[3];
+            return true;
+        }
+
+        static bool write_header(FILE *f) {
+            const uint32_t header[2] = {FILE_MAGIC, FILE_VERSION};
+            return std::fwrite(header, sizeof(header), 1, f) == 1;
+        }
+
+        /** \brief Сбросить файл на диск
+         */
+        static bool sync_file(FILE *f) {
+            if(std::fflush(f) != 0) return false;
+#           if defined(_WIN32)
+            return _commit(_fileno(f)) == 0;
+#           else
+            return fsync(fileno(f)) == 0;
+#           endif
+        }
+
+        int open() {
+            if(file != NULL) return OK;
+            file = std::fopen(path.c_str(), "ab");
+            if(file == NULL) return NO_DATA_ACCESS;
+            if(std::ftell(file) == 0 && !write_header(file)) {
+                close();
+                return NO_DATA_ACCESS;
+            }
+            return OK;
+        }
+
+    public:
+        DealsJournal() {};
+
+        DealsJournal(const DealsJournal&) = delete;
+        DealsJournal &operator = (const DealsJournal&) = delete;
+
+        ~DealsJournal() {
+            close();
+        }
+
+        /** \brief Установить путь к файлу журнала
+         * \param journal_path Путь к файлу журнала
+         */
+        void set_path(const std::string &journal_path) {
+            close();
+            path = journal_path;
+        }
+
+        /** \brief Установить политику сброса журнала на диск
+         *
+         * Каждая запись сразу передается ОС и переживает аварийное завершение программы.
+         * Чтобы запись пережила отключение питания, журнал нужно сбросить на диск.
+         * \param records Количество записей между сбросами на диск. Значение 0 - сброс только методом sync
+         */
+        inline void set_sync_records(const uint32_t records) {
+            sync_records = records;
+        }
+
+        inline uint32_t get_sync_records() const {return sync_records;};
+        inline size_t size() const {return amount_records;};
+
+        /** \brief Закрыть файл журнала
+         */
+        void close() {
+            if(file == NULL) return;
+            std::fclose(file);
+            file = NULL;
+        }
+
+        /** \brief Прочитать сделки из журнала
+         *
+         * Чтение останавливается на первой поврежденной записи, а файл журнала
+         * перезаписывается без нее, чтобы новые записи не оказались за поврежденной
+         * \param deals Массив сделок журнала
+         * \return Вернет 0 в случае успеха, NO_DATA_ACCESS если журнала нет
+         */
+        int load(std::vector<OneDealStruct> &deals) {
+            deals.clear();
+            close();
+            amount_records = 0;
+            FILE *f = std::fopen(path.c_str(), "rb");
+            if(f == NULL) return NO_DATA_ACCESS;
+            uint32_t header[2] = {};
+            bool is_damaged = std::fread(header, sizeof(header), 1, f) != 1 ||
+                header[0] != FILE_MAGIC || header[1] != FILE_VERSION;
+            uint8_t record[RECORD_SIZE];
+            while(!is_damaged) {
+                const size_t n = std::fread(record, 1, RECORD_SIZE, f);
+                if(n == 0) break;
+                OneDealStruct deal;
+                if(n != RECORD_SIZE || !decode_record(record, deal)) {
+                    is_damaged = true;
+                    break;
+                }
+                deals.push_back(deal);
+            }
+            std::fclose(f);
+            if(is_damaged) return reset(deals);
+            amount_records = deals.size();
+            return OK;
+        }
+
+        /** \brief Дописать сделку в журнал
+         * \param deal Сделка
+         * \return Вернет 0 в случае успеха
+         */
+        int append(const OneDealStruct &deal) {
+            int err = open();
+            if(err != OK) return err;
+            uint8_t record[RECORD_SIZE];
+            encode_record(deal, record);
+            if(std::fwrite(record, RECORD_SIZE, 1, file) != 1) return NO_DATA_ACCESS;
+            ++amount_records;
+            if(sync_records > 0 && ++unsynced_records >= sync_records) return sync();
+            if(std::fflush(file) != 0) return NO_DATA_ACCESS;
+            return OK;
+        }
+
+        /** \brief Дописать в журнал массив сделок
+         *
+         * Сделки передаются ОС одной записью, а не по одной
+         * \param begin Итератор начала массива сделок
+         * \param end Итератор конца массива сделок
+         * \return Вернет 0 в случае успеха
+         */
+        template<class ITERATOR>
+        int append(ITERATOR begin, ITERATOR end) {
+            const size_t amount = std::distance(begin, end);
+            if(amount == 0) return OK;
+            int err = open();
+            if(err != OK) return err;
+            std::vector<uint8_t> buffer(amount * RECORD_SIZE);
+            uint8_t *record = buffer.data();
+            for(ITERATOR it = begin; it != end; ++it) {
+                encode_record(*it, record);
+                record += RECORD_SIZE;
+            }
+            if(std::fwrite(buffer.data(), RECORD_SIZE, amount, file) != amount) return NO_DATA_ACCESS;
+            amount_records += amount;
+            if(sync_records > 0) {
+                unsynced_records += amount;
+                if(unsynced_records >= sync_records) return sync();
+            }
+            if(std::fflush(file) != 0) return NO_DATA_ACCESS;
+            return OK;
+        }
+
+        /** \brief Сбросить журнал на диск
+         * \return Вернет 0 в случае успеха
+         */
+        int sync() {
+            unsynced_records = 0;
+            if(file == NULL) return OK;
+            return sync_file(file) ? OK : NO_DATA_ACCESS;
+        }
+
+        /** \brief Заменить содержимое журнала
+         *
+         * Журнал записывается во временный файл, который затем заменяет старый.
+         * Пустой журнал удаляется
+         * \param deals Сделки, которые должны остаться в журнале
+         * \return Вернет 0 в случае успеха
+         */
+        int reset(const std::vector<OneDealStruct> &deals) {
+            close();
+            unsynced_records = 0;
+            amount_records = 0;
+            if(deals.size() == 0) {
+                std::remove(path.c_str());
+                return OK;
+            }
+            const std::string temp_path = path + ".tmp";
+            FILE *f = std::fopen(temp_path.c_str(), "wb");
+            if(f == NULL) return NO_DATA_ACCESS;
+            bool is_ok = write_header(f);
+            uint8_t record[RECORD_SIZE];
+            for(size_t i = 0; i < deals.size() && is_ok; ++i) {
+                encode_record(deals[i], record);
+                is_ok = std::fwrite(record, RECORD_SIZE, 1, f) == 1;
+            }
+            if(is_ok) is_ok = sync_file(f);
+            std::fclose(f);
+            if(!is_ok) {
+                std::remove(temp_path.c_str());
+                return NO_DATA_ACCESS;
+            }
+            std::remove(path.c_str());
+            if(std::rename(temp_path.c_str(), path.c_str()) != 0) return NO_DATA_ACCESS;
+            amount_records = deals.size();
+            return OK;
+        }
+    };
+};
+
+#endif // EASY_BO_DEALS_JOURNAL_HPP_INCLUDED
@@ -0,0 +1,211 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DEALS_QUERY_HPP_INCLUDED
+#define EASY_BO_DEALS_QUERY_HPP_INCLUDED
+
+#include "easy_bo_fast_storage.hpp"
+#include "easy_bo_column_storage.hpp"
+#include <vector>
+#include <bitset>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+namespace easy_bo {
+
+    /** \brief Класс запроса сделок
+     *
+     * Набор условий отбора сделок. Условия разных типов объединяются через И,
+     * несколько значений одного типа (например, несколько символов) - через ИЛИ.
+     * Условия хранятся в виде масок, поэтому проверка сделки не требует разбора запроса.
+     * Пример: DealsQuery().symbol(1).minute_day(600, 720).weekday(xtime::MON)
+     */
+    class DealsQuery {
+    private:
+        enum {
+            USE_SYMBOL = 0x01,
+            USE_NAME = 0x02,
+            USE_GROUP = 0x04,
+            USE_DIRECTION = 0x08,
+            USE_DURATION = 0x10,
+            USE_MINUTE_DAY = 0x20,
+            USE_WEEKDAY = 0x40,
+        };
+
+        uint32_t flags = 0;
+        std::bitset<256> symbols;
+        std::bitset<256> groups;
+        std::vector<std::string> names;     /**< Буферы имен символов размером NAME_SIZE */
+        uint32_t directions = 0;            /**< Маска направлений, бит 0 - продажа, 1 - нет ставки, 2 - покупка */
+        uint32_t min_duration = 0;
+        uint32_t max_duration = 0;
+        uint32_t start_minute_day = 0;
+        uint32_t stop_minute_day = 0;
+        uint32_t weekdays = 0;              /**< Маска дней недели */
+
+    public:
+        DealsQuery() {};
+
+        /** \brief Отобрать сделки по индексу символа
+         * \param symbol_index Индекс символа
+         * \return Ссылка на запрос
+         */
+        DealsQuery &symbol(const uint32_t symbol_index) {
+            flags |= USE_SYMBOL;
+            if(symbol_index < symbols.size()) symbols.set(symbol_index);
+            return *this;
+        }
+
+        /** \brief Отобрать сделки по имени символа
+         * \param symbol_name Имя символа
+         * \return Ссылка на запрос
+         */
+        DealsQuery &name(const std::string &symbol_name) {
+            flags |= USE_NAME;
+            OneDealStruct deal;
+            deal.set_name(symbol_name);
+            names.push_back(std::string((const char*)deal.name, NAME_SIZE));
+            return *this;
+        }
+
+        /** \brief Отобрать сделки по группе
+         * \param group_index Группа сделок
+         * \return Ссылка на запрос
+         */
+        DealsQuery &group(const uint32_t group_index) {
+            flags |= USE_GROUP;
+            if(group_index < groups.size()) groups.set(group_index);
+            return *this;
+        }
+
+        /** \brief Отобрать сделки по направлению
+         * \param deal_direction Направление ставки (EASY_BO_BUY, EASY_BO_SELL или EASY_BO_NO_BET)
+         * \return Ссылка на запрос
+         */
+        DealsQuery &direction(const int8_t deal_direction) {
+            flags |= USE_DIRECTION;
+            if(deal_direction >= -1 && deal_direction <= 1) directions |= 1 << (deal_direction + 1);
+            return *this;
+        }
+
+        /** \brief Отобрать сделки по длительности
+         * \param min_value Минимальная длительность в секундах (включительно)
+         * \param max_value Максимальная длительность в секундах (включительно)
+         * \return Ссылка на запрос
+         */
+        DealsQuery &duration(const uint32_t min_value, const uint32_t max_value) {
+            flags |= USE_DURATION;
+            min_duration = min_value;
+            max_duration = max_value;
+            return *this;
+        }
+
+        /** \brief Отобрать сделки по минуте дня
+         * \param start Начальная минута дня (включительно)
+         * \param stop Конечная минута дня (не включительно)
+         * \return Ссылка на запрос
+         */
+        DealsQuery &minute_day(const uint32_t start, const uint32_t stop) {
+            flags |= USE_MINUTE_DAY;
+            start_minute_day = start;
+            stop_minute_day = stop;
+            return *this;
+        }
+
+        /** \brief Отобрать сделки по дню недели
+         * \param day День недели (xtime::SUN ... xtime::SAT)
+         * \return Ссылка на запрос
+         */
+        DealsQuery &weekday(const uint32_t day) {
+            flags |= USE_WEEKDAY;
+            if(day < xtime::DAYS_IN_WEEK) weekdays |= 1 << day;
+            return *this;
+        }
+
+        /** \brief Проверить, есть ли в запросе условия
+         * \return Вернет true, если запрос пропускает все сделки
+         */
+        inline bool empty() const {
+            return flags == 0;
+        }
+
+        /** \brief Получить набор колонок, нужных для проверки условий
+         * \return Набор колонок (см. ColumnDeals)
+         */
+        uint32_t get_columns() const {
+            uint32_t columns = 0;
+            if(flags & USE_SYMBOL) columns |= ColumnDeals::COLUMN_SYMBOL;
+            if(flags & USE_NAME) columns |= ColumnDeals::COLUMN_NAME;
+            if(flags & USE_GROUP) columns |= ColumnDeals::COLUMN_GROUP;
+            if(flags & USE_DIRECTION) columns |= ColumnDeals::COLUMN_DIRECTION;
+            if(flags & USE_DURATION) columns |= ColumnDeals::COLUMN_DURATION;
+            if(flags & (USE_MINUTE_DAY | USE_WEEKDAY)) columns |= ColumnDeals::COLUMN_TIMESTAMP;
+            return columns;
+        }
+
+        /** \brief Проверить сделку
+         * \param deal Сделка
+         * \return Вернет true, если сделка удовлетворяет запросу
+         */
+        bool check(const OneDealStruct &deal) const {
+            if(flags == 0) return true;
+            if((flags & USE_SYMBOL) && !symbols.test(deal.symbol)) return false;
+            if((flags & USE_GROUP) && !groups.test(deal.group)) return false;
+            if(flags & USE_DIRECTION) {
+                if(deal.direction < -1 || deal.direction > 1) return false;
+                if((directions & (1 << (deal.direction + 1))) == 0) return false;
+            }
+            if((flags & USE_DURATION) &&
+                (deal.duration < min_duration || deal.duration > max_duration)) return false;
+            if(flags & USE_MINUTE_DAY) {
+                const uint32_t minute_day = xtime::get_minute_day(deal.timestamp);
+                if(start_minute_day > minute_day || minute_day >= stop_minute_day) return false;
+            }
+            if((flags & USE_WEEKDAY) &&
+                (weekdays & (1 << xtime::get_weekday(deal.timestamp))) == 0) return false;
+            if(flags & USE_NAME) {
+                bool is_found = false;
+                for(size_t i = 0; i < names.size() && !is_found; ++i) {
+                    is_found = std::memcmp(names[i].data(), deal.name, NAME_SIZE) == 0;
+                }
+                if(!is_found) return false;
+            }
+            return true;
+        }
+
+        /** \brief Отфильтровать массив сделок
+         *
+         * Сделки, не удовлетворяющие запросу, удаляются за один проход с сохранением порядка остальных
+         * \param deals Массив сделок
+         */
+        void apply(std::vector<OneDealStruct> &deals) const {
+            if(flags == 0) return;
+            deals.erase(std::remove_if(deals.begin(), deals.end(), [this](const OneDealStruct &deal) {
+                return !check(deal);
+            }), deals.end());
+        }
+    };
+};
+
+#endif // EASY_BO_DEALS_QUERY_HPP_INCLUDED
@@ -0,0 +1,146 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_DEALS_RETENTION_HPP_INCLUDED
+#define EASY_BO_DEALS_RETENTION_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_deals_query.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+
+namespace easy_bo {
+
+    /** \brief Класс правил хранения сделок
+     *
+     * Определяет, какие дни и сделки удаляются при сжатии хранилища.
+     * Пустые правила сохраняют все сделки.
+     * Пример: DealsRetentionPolicy().keep_days(365).drop(DealsQuery().group(3))
+     */
+    class DealsRetentionPolicy {
+    private:
+        uint32_t max_days = 0;                  /**< Количество хранимых календарных дней, 0 - без ограничения */
+        xtime::timestamp_t min_timestamp = 0;   /**< Дни раньше этой даты удаляются */
+        std::vector<DealsQuery> list_drop;      /**< Удаляемые сделки */
+
+    public:
+        DealsRetentionPolicy() {};
+
+        /** \brief Хранить только последние дни
+         * \param days Количество календарных дней, считая от последнего дня хранилища
+         * \return Ссылка на правила
+         */
+        DealsRetentionPolicy &keep_days(const uint32_t days) {
+            max_days = days;
+            return *this;
+        }
+
+        /** \brief Удалить дни раньше даты
+         * \param timestamp Дата, день этой даты сохраняется
+         * \return Ссылка на правила
+         */
+        DealsRetentionPolicy &drop_before(const xtime::timestamp_t timestamp) {
+            min_timestamp = xtime::get_first_timestamp_day(timestamp);
+            return *this;
+        }
+
+        /** \brief Удалить сделки, удовлетворяющие запросу
+         *
+         * Например, DealsQuery().group(3) удалит группу 3, DealsQuery().name("EURUSD") - символ EURUSD.
+         * Несколько запросов объединяются через ИЛИ
+         * \param query Запрос удаляемых сделок, пустой запрос игнорируется
+         * \return Ссылка на правила
+         */
+        DealsRetentionPolicy &drop(const DealsQuery &query) {
+            if(!query.empty()) list_drop.push_back(query);
+            return *this;
+        }
+
+        /** \brief Получить первый сохраняемый день
+         * \param last_timestamp Метка времени последнего дня хранилища
+         * \return Метка времени начала первого сохраняемого дня
+         */
+        xtime::timestamp_t get_first_day(const xtime::timestamp_t last_timestamp) const {
+            xtime::timestamp_t first_day = min_timestamp;
+            if(max_days > 0) {
+                const xtime::timestamp_t last_day = xtime::get_first_timestamp_day(last_timestamp);
+                const xtime::timestamp_t period = (xtime::timestamp_t)(max_days - 1) * xtime::SECONDS_IN_DAY;
+                if(last_day >= period) first_day = std::max(first_day, last_day - period);
+            }
+            return first_day;
+        }
+
+        /** \brief Удалить сделки по правилам
+         * \param deals Сделки дня
+         * \return Количество удаленных сделок
+         */
+        size_t apply(std::vector<OneDealStruct> &deals) const {
+            if(list_drop.empty()) return 0;
+            const size_t old_size = deals.size();
+            deals.erase(std::remove_if(deals.begin(), deals.end(), [this](const OneDealStruct &deal) {
+                for(size_t i = 0; i < list_drop.size(); ++i) {
+                    if(list_drop[i].check(deal)) return true;
+                }
+                return false;
+            }), deals.end());
+            return old_size - deals.size();
+        }
+    };
+
+    /** \brief Статистика сжатия хранилища
+     */
+    class DealsCompactStats {
+    public:
+        uint32_t days_before = 0;       /**< Количество дней до сжатия */
+        uint32_t days_after = 0;        /**< Количество дней после сжатия */
+        uint64_t deals_before = 0;      /**< Количество сделок до сжатия */
+        uint64_t deals_after = 0;       /**< Количество сделок после сжатия */
+        uint64_t bytes_before = 0;      /**< Размер файла хранилища до сжатия */
+        uint64_t bytes_after = 0;       /**< Размер файла хранилища после сжатия */
+        double scan_seconds_before = 0; /**< Время чтения всех дней до сжатия */
+        double scan_seconds_after = 0;  /**< Время чтения всех дней после сжатия */
+        double seconds = 0;             /**< Время сжатия */
+
+        /** \brief Получить освобожденный объем
+         * \return Разница размеров файла хранилища, может быть отрицательной
+         */
+        inline int64_t get_reclaimed_bytes() const {
+            return (int64_t)bytes_before - (int64_t)bytes_after;
+        }
+
+        /** \brief Получить размер файла
+         * \param path Путь к файлу
+         * \return Размер файла или 0, если файла нет
+         */
+        static uint64_t get_file_size(const std::string &path) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if(!file) return 0;
+            const std::streamoff size = file.tellg();
+            return size > 0 ? (uint64_t)size : 0;
+        }
+    };
+};
+
+#endif // EASY_BO_DEALS_RETENTION_HPP_INCLUDED
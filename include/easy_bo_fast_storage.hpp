@@ -2,6 +2,9 @@
 #define EASY_BO_FAST_STORAGE_HPP_INCLUDED
 
 #include "xquotes_daily_data_storage.hpp"
+#include <vector>
+#include <memory>
+#include <algorithm>
 #include <cstring>
 
 namespace easy_bo {
@@ -22,7 +25,7 @@ namespace easy_bo {
 
         OneDealStruct() {};
 
-        bool operator == (const OneDealStruct &b) {
+        bool operator == (const OneDealStruct &b) const {
             return ( timestamp == b.timestamp &&
                 duration == b.duration &&
                 direction == b.direction &&
@@ -32,7 +35,7 @@ namespace easy_bo {
                 std::equal(name, name + NAME_SIZE, b.name));
         }
 
-        bool operator != (const OneDealStruct &b) {
+        bool operator != (const OneDealStruct &b) const {
             return ( timestamp != b.timestamp ||
                 duration != b.duration ||
                 direction != b.direction ||
@@ -55,16 +58,132 @@ namespace easy_bo {
          * \param symbol_name Имя символа
          */
         void set_name(const std::string &symbol_name) {
-            const size_t min_size = std::min(symbol_name.length(), NAME_SIZE);
+            const size_t min_size = std::min(symbol_name.length(), NAME_SIZE - 1);
+            std::fill(name, name + NAME_SIZE, 0);
             std::strncpy((char*)name, (const char*)symbol_name.c_str(), min_size);
         }
+
+        /** \brief Сравнить имя символа
+         *
+         * Сравнивает буфер имени без создания std::string
+         * \param b Сделка с именем для сравнения
+         * \return Вернет true, если имена совпадают
+         */
+        inline bool is_equal_name(const OneDealStruct &b) const {
+            return std::memcmp(name, b.name, NAME_SIZE) == 0;
+        }
     };
 
+    /** \brief Класс для доступа к массиву сделок без копирования
+     *
+     * Не владеет данными, поэтому остается действительным только пока жив источник данных
+     */
+    class DealsSpan {
+    private:
+        const OneDealStruct *deals_ptr = nullptr;
+        size_t deals_size = 0;
+    public:
+        typedef const OneDealStruct* const_iterator;
+
+        DealsSpan() {};
+
+        DealsSpan(const OneDealStruct *ptr, const size_t size) :
+            deals_ptr(ptr), deals_size(size) {
+        };
+
+        inline const OneDealStruct* begin() const {return deals_ptr;};
+        inline const OneDealStruct* end() const {return deals_ptr + deals_size;};
+        inline const OneDealStruct* data() const {return deals_ptr;};
+        inline size_t size() const {return deals_size;};
+        inline bool empty() const {return deals_size == 0;};
+
+        inline const OneDealStruct &operator[](const size_t index) const {
+            return deals_ptr[index];
+        }
+    };
+
+    /** \brief Сортировка сделок по метке времени
+     *
+     * Сделки одного дня сортируются устойчивой поразрядной сортировкой по секунде дня
+     * (два прохода по 9 бит), порядок сделок с одинаковой меткой времени сохраняется.
+     * Сделки нескольких дней сортируются std::stable_sort
+     * \param deals_ptr Массив сделок
+     * \param deals Количество сделок
+     */
+    inline void sort_deals_timestamp(OneDealStruct *deals_ptr, const size_t deals) {
+        if(deals < 2) return;
+        bool is_sorted = true;
+        for(size_t d = 1; d < deals && is_sorted; ++d) {
+            is_sorted = deals_ptr[d - 1].timestamp <= deals_ptr[d].timestamp;
+        }
+        if(is_sorted) return;
+        const xtime::timestamp_t first_day = xtime::get_first_timestamp_day(deals_ptr[0].timestamp);
+        bool is_one_day = true;
+        for(size_t d = 1; d < deals && is_one_day; ++d) {
+            is_one_day = xtime::get_first_timestamp_day(deals_ptr[d].timestamp) == first_day;
+        }
+        if(!is_one_day) {
+            std::stable_sort(deals_ptr, deals_ptr + deals,
+                [](const OneDealStruct &a, const OneDealStruct &b) {
+                    return a.timestamp < b.timestamp;
+                });
+            return;
+        }
+        const uint32_t RADIX_BITS = 9;
+        const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+        const uint32_t RADIX_MASK = RADIX_SIZE - 1;
+        /* гистограммы обоих разрядов считаются за один проход */
+        std::vector<uint32_t> offsets(2 * RADIX_SIZE, 0);
+        for(size_t d = 0; d < deals; ++d) {
+            const uint32_t second = deals_ptr[d].timestamp - first_day;
+            ++offsets[second & RADIX_MASK];
+            ++offsets[RADIX_SIZE + ((second >> RADIX_BITS) & RADIX_MASK)];
+        }
+        for(uint32_t pass = 0; pass < 2; ++pass) {
+            uint32_t sum = 0;
+            for(uint32_t i = pass * RADIX_SIZE; i < (pass + 1) * RADIX_SIZE; ++i) {
+                const uint32_t count = offsets[i];
+                offsets[i] = sum;
+                sum += count;
+            }
+        }
+        std::unique_ptr<uint8_t[]> temp(new uint8_t[deals * sizeof(OneDealStruct)]);
+        OneDealStruct *src = deals_ptr;
+        OneDealStruct *dst = (OneDealStruct*)temp.get();
+        for(uint32_t pass = 0; pass < 2; ++pass) {
+            uint32_t *pass_offsets = offsets.data() + pass * RADIX_SIZE;
+            const uint32_t shift = pass * RADIX_BITS;
+            for(size_t d = 0; d < deals; ++d) {
+                const uint32_t second = src[d].timestamp - first_day;
+                std::memcpy(dst + pass_offsets[(second >> shift) & RADIX_MASK]++, src + d, sizeof(OneDealStruct));
+            }
+            std::swap(src, dst);
+        }
+        /* после двух проходов данные вернулись в исходный массив */
+    }
+
     class ArrayDeals {
     private:
         std::unique_ptr<uint8_t[]> byte_array;  /**< Массив с данными */
         size_t byte_array_size = 0;
+        size_t byte_array_capacity = 0;         /**< Размер выделенной памяти */
         uint8_t *byte_array_ptr = nullptr;
+
+        /** \brief Выделить память под данные
+         *
+         * Память растет в геометрической прогрессии, данные сохраняются
+         * \param size Требуемый размер данных
+         */
+        void reserve_bytes(const size_t size) {
+            if(size <= byte_array_capacity) return;
+            const size_t capacity = std::max(size, 2 * byte_array_capacity);
+            std::unique_ptr<uint8_t[]> new_array(new uint8_t[capacity]);
+            if(byte_array_size > 0) std::memcpy(new_array.get(), byte_array.get(), byte_array_size);
+            byte_array = std::move(new_array);
+            byte_array_capacity = capacity;
+            byte_array_ptr = byte_array.get();
+        }
+
     public:
         enum {
             COMPARE_TIMESTAMP = 0,
@@ -77,29 +196,21 @@ namespace easy_bo {
          */
         virtual ArrayDeals & operator = (const ArrayDeals &array_deals) {
             if(this != &array_deals) {
-                if(byte_array_size != array_deals.byte_array_size) {
-                    byte_array_size = array_deals.byte_array_size;
-                    byte_array = std::unique_ptr<uint8_t[]>(new uint8_t[byte_array_size]);
-                }
-                uint8_t *dst_data = byte_array.get();
-                uint8_t *src_data = array_deals.byte_array.get();
-                std::copy(src_data, src_data + byte_array_size, dst_data);
-                byte_array_ptr = byte_array.get();
+                /* источник читается через data() и size(), т.к. это может быть ArrayDealsView */
+                const size_t size = array_deals.size();
+                byte_array_size = 0;
+                reserve_bytes(size);
+                byte_array_size = size;
+                if(byte_array_size > 0) std::memcpy(byte_array_ptr, array_deals.data(), byte_array_size);
             }
             return *this;
         }
 
         ArrayDeals(const ArrayDeals &array_deals) {
-            if(this != &array_deals) {
-                if(byte_array_size != array_deals.byte_array_size) {
-                    byte_array_size = array_deals.byte_array_size;
-                    byte_array = std::unique_ptr<uint8_t[]>(new uint8_t[byte_array_size]);
-                }
-                uint8_t *dst_data = byte_array.get();
-                uint8_t *src_data = array_deals.byte_array.get();
-                std::copy(src_data, src_data + byte_array_size, dst_data);
-                byte_array_ptr = byte_array.get();
-            }
+            const size_t size = array_deals.size();
+            reserve_bytes(size);
+            byte_array_size = size;
+            if(byte_array_size > 0) std::memcpy(byte_array_ptr, array_deals.data(), byte_array_size);
         }
 
         virtual bool empty() {
@@ -107,13 +218,11 @@ namespace easy_bo {
         }
 
         virtual void assign(const char* s, size_t n) {
-            if(n != byte_array_size) {
-                byte_array = std::unique_ptr<uint8_t[]>(new uint8_t[n]);
-                byte_array_size = n;
-            }
-            char *point = (char*)byte_array.get();
-            std::copy(s, s + n, point);
-            byte_array_ptr = byte_array.get();
+            /* старые данные заменяются целиком, копировать их не нужно */
+            byte_array_size = 0;
+            reserve_bytes(n);
+            byte_array_size = n;
+            if(n > 0) std::memcpy(byte_array_ptr, s, n);
         }
 
         virtual size_t size() const {
@@ -126,6 +235,40 @@ namespace easy_bo {
 
         /* дальше пользовательские методы/конструкторы */
 
+        ArrayDeals(ArrayDeals &&array_deals) noexcept :
+                byte_array(std::move(array_deals.byte_array)),
+                byte_array_size(array_deals.byte_array_size),
+                byte_array_capacity(array_deals.byte_array_capacity),
+                byte_array_ptr(array_deals.byte_array_ptr) {
+            array_deals.byte_array_size = 0;
+            array_deals.byte_array_capacity = 0;
+            array_deals.byte_array_ptr = nullptr;
+        }
+
+        ArrayDeals &operator = (ArrayDeals &&array_deals) noexcept {
+            if(this != &array_deals) {
+                byte_array = std::move(array_deals.byte_array);
+                byte_array_size = array_deals.byte_array_size;
+                byte_array_capacity = array_deals.byte_array_capacity;
+                byte_array_ptr = array_deals.byte_array_ptr;
+                array_deals.byte_array_size = 0;
+                array_deals.byte_array_capacity = 0;
+                array_deals.byte_array_ptr = nullptr;
+            }
+            return *this;
+        }
+
+        virtual ~ArrayDeals() {};
+
+        /** \brief Получить сделки без копирования
+         *
+         * Массив остается действительным, пока не изменится размер массива сделок
+         * \return Массив сделок
+         */
+        inline DealsSpan get_span() const {
+            return DealsSpan((const OneDealStruct*)byte_array_ptr, byte_array_size / sizeof(OneDealStruct));
+        }
+
         /** \brief Получить количество сделок
          * \return Количество сделок
          */
@@ -137,6 +280,13 @@ namespace easy_bo {
             set_amount_deals(deals);
         }
 
+        /** \brief Зарезервировать память под сделки
+         * \param deals Количество сделок
+         */
+        void reserve(const uint32_t deals) {
+            reserve_bytes((size_t)deals * sizeof(OneDealStruct));
+        }
+
         private:
 
         /** \brief Проверка отсортированности по метке времени
@@ -150,38 +300,6 @@ namespace easy_bo {
             return true;
         }
 
-        /** \brief Быстрая сортировка Хоара. Сортирует массив по возрастанию
-         *
-         * \param a массив, который нужно отсортировать
-         * \param l индекс первого элемента массива
-         * \param r индекс последнего элемента массива (это не размер массива!)
-         */
-        template<const int type_comp, typename T>
-        void quick_sort(T* a, long l, long r) {
-            long i = l, j = r;
-            T temp, p;
-            p = a[l + (r - l)/2];
-            do {
-                switch(type_comp) {
-                case COMPARE_TIMESTAMP:
-                    while(a[i].timestamp < p.timestamp) i++;
-                    while(a[j].timestamp > p.timestamp) j--;
-                    break;
-                }
-
-                if(i<= j) {
-                    temp = a[i];
-                    a[i] = a[j];
-                    a[j] = temp;
-                    i++; j--;
-                }
-            } while (i <=j);
-            if(i < r)
-                quick_sort<type_comp, T>(a, i, r);
-            if(l < j)
-                quick_sort<type_comp, T>(a, l , j);
-        };
-
         template<class T>
         size_t binary_search_timestamp(
                 T* data,
@@ -206,29 +324,28 @@ namespace easy_bo {
             return high;
         }
 
+        public:
+
         /** \brief Сортировка сделок по метке времени
+         *
+         * Порядок сделок с одинаковой меткой времени сохраняется (см. sort_deals_timestamp)
          */
         void sort_timestamp() {
             if(is_sorted_timestamp()) return;
-            const uint32_t deals = get_amount_deals();
-            OneDealStruct *deals_ptr = (OneDealStruct*)byte_array_ptr;
-            quick_sort<COMPARE_TIMESTAMP, OneDealStruct>(deals_ptr, 0, deals - 1);
+            sort_deals_timestamp((OneDealStruct*)byte_array_ptr, get_amount_deals());
         }
 
-        public:
-
         /** \brief Установить количество сделок
+         *
+         * Уже записанные сделки сохраняются, новые сделки заполняются нулями
          * \param deals Количество сделок
          */
         void set_amount_deals(const uint32_t deals) {
             const size_t old_size = byte_array_size;
-            const size_t new_size = deals * sizeof(OneDealStruct);
-            if(new_size != byte_array_size) {
-                byte_array = std::unique_ptr<uint8_t[]>(new uint8_t[new_size]);
-                byte_array_size = new_size;
-                byte_array_ptr = byte_array.get();
-                std::fill(byte_array_ptr + old_size, byte_array_ptr + byte_array_size, '\0');
-            }
+            const size_t new_size = (size_t)deals * sizeof(OneDealStruct);
+            reserve_bytes(new_size);
+            byte_array_size = new_size;
+            if(new_size > old_size) std::fill(byte_array_ptr + old_size, byte_array_ptr + new_size, 0);
         }
 
         /** \brief Получить сделку по индексу
@@ -249,12 +366,15 @@ namespace easy_bo {
         }
 
         /** \brief Добавить сделку
+         *
+         * Память растет в геометрической прогрессии, поэтому добавление сделок в цикле
+         * не выделяет память на каждую сделку
          * \param deal Сделка
          */
         void add_deal(const OneDealStruct &deal) {
-            const uint32_t deals = get_amount_deals();
-            set_amount_deals(deals + 1);
-            set_deal(deal, deals);
+            reserve_bytes(byte_array_size + sizeof(OneDealStruct));
+            std::memcpy(byte_array_ptr + byte_array_size, &deal, sizeof(OneDealStruct));
+            byte_array_size += sizeof(OneDealStruct);
         }
 
         /** \brief Получить вектор сделок
@@ -272,10 +392,89 @@ namespace easy_bo {
          */
         void set_vector(const std::vector<OneDealStruct> &deals) {
             set_amount_deals(deals.size());
-            OneDealStruct *deals_ptr = (OneDealStruct*)byte_array_ptr;
-            for(size_t i = 0; i < deals.size(); ++i) {
-                deals_ptr[i] = deals[i];
+            std::copy(deals.begin(), deals.end(), (OneDealStruct*)byte_array_ptr);
+        }
+    };
+
+    /** \brief Класс массива сделок в памяти вектора сделок
+     *
+     * Хранилище дней читает данные дня прямо в вектор и записывает их из вектора
+     * без промежуточного массива. Вектор должен существовать, пока используется этот класс.
+     * Собственного массива у класса нет, поэтому методы ArrayDeals скрыты,
+     * хранилищу передается только ссылка из get_array()
+     */
+    class ArrayDealsView : protected ArrayDeals {
+    private:
+        std::vector<OneDealStruct> *deals_ptr = nullptr;
+        const std::vector<OneDealStruct> *const_deals_ptr = nullptr;
+        bool is_broken = false;
+
+    public:
+
+        /** \brief Массив для чтения дня в вектор
+         * \param deals Вектор сделок, его емкость используется повторно
+         */
+        ArrayDealsView(std::vector<OneDealStruct> &deals) :
+            deals_ptr(&deals), const_deals_ptr(&deals) {};
+
+        /** \brief Массив для записи дня из вектора
+         * \param deals Вектор сделок
+         */
+        ArrayDealsView(const std::vector<OneDealStruct> &deals) :
+            const_deals_ptr(&deals) {};
+
+        ArrayDealsView(const ArrayDealsView&) = delete;
+        ArrayDealsView &operator = (const ArrayDealsView&) = delete;
+
+        /** \brief Получить массив для передачи в хранилище дней
+         * \return Ссылка на массив сделок
+         */
+        inline ArrayDeals &get_array() {
+            return *this;
+        }
+
+        /** \brief Проверить, что данные дня не были повреждены
+         *
+         * Данные повреждены, если их размер не кратен размеру сделки.
+         * В этом случае вектор сделок очищается
+         * \return Вернет true, если последние данные дня повреждены
+         */
+        inline bool check_broken() const {
+            return is_broken;
+        }
+
+        /** \brief Скопировать данные дня в вектор сделок
+         *
+         * Хранилище дней копирует данные через ссылку на ArrayDeals,
+         * поэтому копирование идет в вектор, а не в пустой массив базового класса
+         * \param array_deals Массив сделок
+         */
+        virtual ArrayDeals & operator = (const ArrayDeals &array_deals) {
+            if(this != &array_deals) assign(array_deals.data(), array_deals.size());
+            return *this;
+        }
+
+        virtual bool empty() {
+            return const_deals_ptr->empty();
+        }
+
+        virtual void assign(const char* s, size_t n) {
+            if(deals_ptr == nullptr) return;
+            is_broken = (n % sizeof(OneDealStruct)) != 0;
+            if(is_broken) {
+                deals_ptr->clear();
+                return;
             }
+            deals_ptr->resize(n / sizeof(OneDealStruct));
+            if(deals_ptr->size() > 0) std::memcpy((void*)deals_ptr->data(), s, n);
+        }
+
+        virtual size_t size() const {
+            return const_deals_ptr->size() * sizeof(OneDealStruct);
+        }
+
+        virtual const char* data() const noexcept {
+            return (const char*)const_deals_ptr->data();
         }
     };
 
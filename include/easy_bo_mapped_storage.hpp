@@ -0,0 +1,619 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_MAPPED_STORAGE_HPP_INCLUDED
+#define EASY_BO_MAPPED_STORAGE_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace easy_bo {
+
+    /** \brief Класс файла, отображенного в память только для чтения
+     *
+     * Страницы файла разделяются через кэш ОС между всеми процессами, открывшими этот файл
+     */
+    class MappedFile {
+    private:
+        const uint8_t *file_data = nullptr;
+        size_t file_size = 0;
+#       if defined(_WIN32)
+        HANDLE file_handle = INVALID_HANDLE_VALUE;
+        HANDLE mapping_handle = NULL;
+#       endif
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator = (const MappedFile &) = delete;
+
+    public:
+        MappedFile() {};
+
+        MappedFile(const std::string &path) {
+            open(path);
+        };
+
+        ~MappedFile() {
+            close();
+        }
+
+        /** \brief Открыть файл
+         * \param path Путь к файлу
+         * \return Вернет true в случае успеха
+         */
+        bool open(const std::string &path) {
+            close();
+#           if defined(_WIN32)
+            file_handle = CreateFileA(
+                path.c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ,
+                NULL,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                NULL);
+            if(file_handle == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER size;
+            if(!GetFileSizeEx(file_handle, &size) || size.QuadPart == 0) {
+                close();
+                return false;
+            }
+            mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping_handle == NULL) {
+                close();
+                return false;
+            }
+            file_data = (const uint8_t*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+            if(file_data == nullptr) {
+                close();
+                return false;
+            }
+            file_size = size.QuadPart;
+#           else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) return false;
+            struct stat st;
+            if(fstat(fd, &st) != 0 || st.st_size == 0) {
+                ::close(fd);
+                return false;
+            }
+            void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(ptr == MAP_FAILED) return false;
+            file_data = (const uint8_t*)ptr;
+            file_size = st.st_size;
+#           endif
+            return true;
+        }
+
+        /** \brief Закрыть файл
+         */
+        void close() {
+#           if defined(_WIN32)
+            if(file_data != nullptr) UnmapViewOfFile(file_data);
+            if(mapping_handle != NULL) CloseHandle(mapping_handle);
+            if(file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+            mapping_handle = NULL;
+            file_handle = INVALID_HANDLE_VALUE;
+#           else
+            if(file_data != nullptr) munmap((void*)file_data, file_size);
+#           endif
+            file_data = nullptr;
+            file_size = 0;
+        }
+
+        inline const uint8_t *data() const {return file_data;};
+        inline size_t size() const {return file_size;};
+        inline bool is_open() const {return file_data != nullptr;};
+    };
+
+    /** \brief Класс манифеста снимков хранилища
+     *
+     * Манифест описывает опубликованную версию хранилища: номер поколения,
+     * список файлов-сегментов в формате MappedDealsStorage и сегмент, в котором лежит каждый день.
+     * Сегменты не изменяются после записи, а манифест заменяется атомарным переименованием,
+     * поэтому читатель всегда видит целую версию хранилища.
+     * Файл сегмента имеет имя <путь к манифесту>.<номер сегмента>
+     */
+    class MappedDealsManifest {
+    public:
+        static const uint32_t FILE_MAGIC = 0x534D4245;  /**< Сигнатура файла "EBMS" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+
+        /** \brief Запись дня манифеста
+         */
+        class Day {
+        public:
+            uint64_t timestamp = 0;     /**< Метка времени начала дня */
+            uint64_t segment = 0;       /**< Номер сегмента, содержащего день */
+        };
+
+        uint64_t generation = 0;            /**< Номер поколения, совпадает с номером последнего сегмента */
+        std::vector<uint64_t> segments;     /**< Номера используемых сегментов по возрастанию */
+        std::vector<Day> days;              /**< Дни по возрастанию метки времени */
+
+        MappedDealsManifest() {};
+
+        /** \brief Получить путь к файлу сегмента
+         * \param path Путь к манифесту
+         * \param segment Номер сегмента
+         * \return Путь к файлу сегмента
+         */
+        static std::string get_segment_path(const std::string &path, const uint64_t segment) {
+            return path + "." + std::to_string(segment);
+        }
+
+        /** \brief Загрузить манифест
+         * \param path Путь к манифесту
+         * \return Вернет 0 в случае успеха
+         */
+        int load(const std::string &path) {
+            generation = 0;
+            segments.clear();
+            days.clear();
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if(!file) return NO_DATA_ACCESS;
+            const std::streamoff file_size = file.tellg();
+            file.seekg(0);
+            uint32_t header[2] = {};
+            uint64_t file_generation = 0;
+            uint32_t amount[2] = {};
+            if(!file.read((char*)header, sizeof(header)) ||
+                !file.read((char*)&file_generation, sizeof(file_generation)) ||
+                !file.read((char*)amount, sizeof(amount))) return PARSER_ERROR;
+            if(header[0] != FILE_MAGIC || header[1] != FILE_VERSION) return PARSER_ERROR;
+            /* количество записей проверяется по размеру файла до выделения памяти */
+            const uint64_t data_size = (uint64_t)amount[0] * sizeof(uint64_t) + (uint64_t)amount[1] * sizeof(Day);
+            if(data_size > (uint64_t)file_size - (sizeof(header) + sizeof(file_generation) + sizeof(amount))) return PARSER_ERROR;
+            segments.resize(amount[0]);
+            days.resize(amount[1]);
+            if(segments.size() > 0 &&
+                !file.read((char*)segments.data(), segments.size() * sizeof(uint64_t))) return PARSER_ERROR;
+            if(days.size() > 0 &&
+                !file.read((char*)days.data(), days.size() * sizeof(Day))) return PARSER_ERROR;
+            generation = file_generation;
+            return OK;
+        }
+
+        /** \brief Записать манифест
+         *
+         * Манифест записывается во временный файл, который затем заменяет старый
+         * \param path Путь к манифесту
+         * \return Вернет 0 в случае успеха
+         */
+        int save(const std::string &path) const {
+            const std::string temp_path = path + ".tmp";
+            {
+                std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+                if(!file) return NO_DATA_ACCESS;
+                const uint32_t header[2] = {FILE_MAGIC, FILE_VERSION};
+                const uint32_t amount[2] = {(uint32_t)segments.size(), (uint32_t)days.size()};
+                file.write((const char*)header, sizeof(header));
+                file.write((const char*)&generation, sizeof(generation));
+                file.write((const char*)amount, sizeof(amount));
+                if(segments.size() > 0) file.write((const char*)segments.data(), segments.size() * sizeof(uint64_t));
+                if(days.size() > 0) file.write((const char*)days.data(), days.size() * sizeof(Day));
+                if(!file) return NO_DATA_ACCESS;
+            }
+#           if defined(_WIN32)
+            if(!MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) return NO_DATA_ACCESS;
+#           else
+            if(std::rename(temp_path.c_str(), path.c_str()) != 0) return NO_DATA_ACCESS;
+#           endif
+            return OK;
+        }
+    };
+
+    /** \brief Класс хранилища сделок, отображенного в память только для чтения
+     *
+     * Файл хранилища содержит несжатые массивы OneDealStruct, отсортированные по времени
+     * и выровненные по 8 байт, поэтому сделки дня доступны без копирования через DealsSpan.
+     * Файл создается методом DealsDataStoreTemplate::write_mapped_file или классом MappedDealsWriter.
+     * Вместо файла хранилища можно открыть манифест снимков (см. MappedDealsManifest,
+     * DealsDataStoreTemplate::publish_snapshot), тогда хранилище видит одну версию данных,
+     * пока не будет вызван метод refresh
+     */
+    class MappedDealsStorage {
+    public:
+        static const uint32_t FILE_MAGIC = 0x444D4245;  /**< Сигнатура файла "EBMD" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+
+        /** \brief Заголовок файла
+         */
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t record_size;
+            uint32_t amount_days;
+            uint64_t index_offset;  /**< Смещение индекса дней, индекс записан после всех сделок */
+        };
+
+        /** \brief Запись индекса дней
+         */
+        struct DayIndex {
+            uint64_t timestamp;     /**< Метка времени начала дня */
+            uint64_t offset;        /**< Смещение массива сделок от начала файла */
+            uint64_t amount_deals;  /**< Количество сделок */
+        };
+
+    private:
+        static const uint32_t MAX_OPEN_ATTEMPTS = 8;    /**< Количество попыток открыть снимок, который заменяется во время открытия */
+
+        /** \brief День хранилища
+         */
+        class Day {
+        public:
+            uint64_t timestamp = 0;
+            const OneDealStruct *deals = nullptr;
+            size_t amount_deals = 0;
+        };
+
+        std::string storage_path;
+        std::vector<std::unique_ptr<MappedFile>> list_files;
+        std::vector<Day> list_days;
+        uint64_t generation = 0;
+        bool is_snapshot = false;
+
+        /** \brief Проверить файл хранилища и получить его индекс дней
+         * \param file Отображенный в память файл
+         * \param index Индекс дней
+         * \param amount_days Количество дней
+         * \return Вернет 0 в случае успеха
+         */
+        static int parse_file(const MappedFile &file, const DayIndex *&index, size_t &amount_days) {
+            Header header;
+            if(file.size() < sizeof(Header)) return PARSER_ERROR;
+            std::copy(file.data(), file.data() + sizeof(Header), (uint8_t*)&header);
+            if(header.magic != FILE_MAGIC ||
+                header.version != FILE_VERSION ||
+                header.record_size != sizeof(OneDealStruct) ||
+                header.index_offset % alignof(DayIndex) != 0 ||
+                header.index_offset < sizeof(Header) ||
+                header.index_offset > file.size()) {
+                return PARSER_ERROR;
+            }
+            /* размеры проверяются делением, чтобы сумма смещения и размера не переполнилась */
+            if(header.amount_days > (file.size() - header.index_offset) / sizeof(DayIndex)) return PARSER_ERROR;
+            index = (const DayIndex*)(file.data() + header.index_offset);
+            for(size_t i = 0; i < header.amount_days; ++i) {
+                if(index[i].offset % alignof(OneDealStruct) != 0 ||
+                    index[i].offset < sizeof(Header) ||
+                    index[i].offset > header.index_offset ||
+                    index[i].amount_deals > (header.index_offset - index[i].offset) / sizeof(OneDealStruct) ||
+                    (i > 0 && index[i].timestamp <= index[i - 1].timestamp)) {
+                    return PARSER_ERROR;
+                }
+            }
+            amount_days = header.amount_days;
+            return OK;
+        }
+
+        static Day get_day(const MappedFile &file, const DayIndex &index) {
+            Day day;
+            day.timestamp = index.timestamp;
+            day.deals = (const OneDealStruct*)(file.data() + index.offset);
+            day.amount_deals = index.amount_deals;
+            return day;
+        }
+
+        /** \brief Открыть одиночный файл хранилища
+         */
+        int open_file(
+                const std::string &path,
+                std::vector<std::unique_ptr<MappedFile>> &files,
+                std::vector<Day> &days) {
+            std::unique_ptr<MappedFile> file(new MappedFile());
+            if(!file->open(path)) return NO_DATA_ACCESS;
+            const DayIndex *index = nullptr;
+            size_t amount_days = 0;
+            int err = parse_file(*file, index, amount_days);
+            if(err != OK) return err;
+            days.reserve(amount_days);
+            for(size_t i = 0; i < amount_days; ++i) {
+                days.push_back(get_day(*file, index[i]));
+            }
+            files.push_back(std::move(file));
+            return OK;
+        }
+
+        /** \brief Открыть снимок по манифесту
+         *
+         * Если манифест заменили во время открытия и старый сегмент уже удален, снимок открывается заново
+         */
+        int open_snapshot(
+                const std::string &path,
+                std::vector<std::unique_ptr<MappedFile>> &files,
+                std::vector<Day> &days,
+                uint64_t &snapshot_generation) {
+            int err = OK;
+            for(uint32_t attempt = 0; attempt < MAX_OPEN_ATTEMPTS; ++attempt) {
+                files.clear();
+                days.clear();
+                MappedDealsManifest manifest;
+                err = manifest.load(path);
+                if(err != OK) continue;
+                std::vector<const DayIndex*> list_index(manifest.segments.size());
+                std::vector<size_t> list_amount(manifest.segments.size());
+                for(size_t s = 0; s < manifest.segments.size() && err == OK; ++s) {
+                    std::unique_ptr<MappedFile> file(new MappedFile());
+                    if(!file->open(MappedDealsManifest::get_segment_path(path, manifest.segments[s]))) {
+                        err = NO_DATA_ACCESS;
+                        break;
+                    }
+                    err = parse_file(*file, list_index[s], list_amount[s]);
+                    files.push_back(std::move(file));
+                }
+                if(err != OK) continue;
+                days.reserve(manifest.days.size());
+                for(size_t d = 0; d < manifest.days.size() && err == OK; ++d) {
+                    const MappedDealsManifest::Day &manifest_day = manifest.days[d];
+                    auto it_segment = std::lower_bound(
+                        manifest.segments.begin(),
+                        manifest.segments.end(),
+                        manifest_day.segment);
+                    if(it_segment == manifest.segments.end() || *it_segment != manifest_day.segment) {
+                        err = PARSER_ERROR;
+                        break;
+                    }
+                    const size_t s = it_segment - manifest.segments.begin();
+                    const DayIndex *index_end = list_index[s] + list_amount[s];
+                    const DayIndex *it = std::lower_bound(list_index[s], index_end, manifest_day.timestamp,
+                        [](const DayIndex &lhs, const uint64_t &value) {
+                        return lhs.timestamp < value;
+                    });
+                    if(it == index_end || it->timestamp != manifest_day.timestamp) {
+                        err = PARSER_ERROR;
+                        break;
+                    }
+                    days.push_back(get_day(*files[s], *it));
+                }
+                if(err != OK) continue;
+                snapshot_generation = manifest.generation;
+                return OK;
+            }
+            files.clear();
+            days.clear();
+            return err;
+        }
+
+        const Day *find_day(const xtime::timestamp_t timestamp) const {
+            const uint64_t day = xtime::get_first_timestamp_day(timestamp);
+            auto it = std::lower_bound(list_days.begin(), list_days.end(), day,
+                [](const Day &lhs, const uint64_t &value) {
+                return lhs.timestamp < value;
+            });
+            if(it == list_days.end() || it->timestamp != day) return nullptr;
+            return &(*it);
+        }
+
+    public:
+        MappedDealsStorage() {};
+
+        /** \brief Открыть хранилище
+         * \param path Путь к файлу хранилища или манифесту снимков
+         */
+        MappedDealsStorage(const std::string &path) {
+            open(path);
+        };
+
+        /** \brief Открыть хранилище
+         * \param path Путь к файлу хранилища или манифесту снимков
+         * \return Вернет 0 в случае успеха
+         */
+        int open(const std::string &path) {
+            list_days.clear();
+            list_files.clear();
+            storage_path = path;
+            generation = 0;
+            uint32_t magic = 0;
+            {
+                std::ifstream file(path, std::ios::binary);
+                if(!file || !file.read((char*)&magic, sizeof(magic))) return NO_DATA_ACCESS;
+            }
+            is_snapshot = magic == MappedDealsManifest::FILE_MAGIC;
+            if(is_snapshot) return open_snapshot(path, list_files, list_days, generation);
+            return open_file(path, list_files, list_days);
+        }
+
+        /** \brief Перейти к последнему опубликованному снимку
+         *
+         * Массивы сделок, полученные методом get_day_span до обновления, становятся недействительными.
+         * Если новый снимок открыть не удалось, остается текущий
+         * \param is_changed Флаг, будет установлен, если версия данных изменилась
+         * \return Вернет 0 в случае успеха
+         */
+        int refresh(bool &is_changed) {
+            is_changed = false;
+            if(!is_snapshot) return OK;
+            MappedDealsManifest manifest;
+            int err = manifest.load(storage_path);
+            if(err != OK) return err;
+            if(manifest.generation == generation) return OK;
+            std::vector<std::unique_ptr<MappedFile>> files;
+            std::vector<Day> days;
+            uint64_t snapshot_generation = 0;
+            err = open_snapshot(storage_path, files, days, snapshot_generation);
+            if(err != OK) return err;
+            list_files.swap(files);
+            list_days.swap(days);
+            generation = snapshot_generation;
+            is_changed = true;
+            return OK;
+        }
+
+        /** \brief Получить номер поколения снимка
+         * \return Номер поколения или 0, если открыт одиночный файл хранилища
+         */
+        inline uint64_t get_generation() const {return generation;};
+
+        /** \brief Проверить наличие сделок за торговый день
+         * \param timestamp Метка времени
+         * \return Вернет true, если день есть в хранилище
+         */
+        bool check_timestamp(const xtime::timestamp_t timestamp) const {
+            return find_day(timestamp) != nullptr;
+        }
+
+        /** \brief Узнать максимальную и минимальную метку времени дней
+         * \param min_timestamp Метка времени в начале дня начала исторических данных
+         * \param max_timestamp Метка времени в начале дня конца исторических данных
+         * \return Вернет 0 в случае успеха
+         */
+        int get_min_max_timestamp(xtime::timestamp_t &min_timestamp, xtime::timestamp_t &max_timestamp) const {
+            if(list_days.empty()) return NO_DATA_ACCESS;
+            min_timestamp = list_days.front().timestamp;
+            max_timestamp = list_days.back().timestamp;
+            return OK;
+        }
+
+        /** \brief Получить сделки за торговый день без копирования
+         * \param deals Массив сделок, указывающий на отображенный в память файл
+         * \param timestamp Метка времени
+         * \return Вернет 0 в случае успеха
+         */
+        int get_day_span(DealsSpan &deals, const xtime::timestamp_t timestamp) const {
+            const Day *day = find_day(timestamp);
+            if(day == nullptr) {
+                deals = DealsSpan();
+                return NO_DATA_ACCESS;
+            }
+            deals = DealsSpan(day->deals, day->amount_deals);
+            return OK;
+        }
+
+        /* методы для совместимости с DealsDataStoreTemplate */
+
+        void set_indent(const uint32_t /* indent_timestamp_past */, const uint32_t /* indent_timestamp_future */) {};
+
+        void save() {};
+    };
+
+    /** \brief Класс для записи файла MappedDealsStorage
+     *
+     * Дни должны добавляться в порядке возрастания даты, сделки дня - в порядке возрастания времени
+     */
+    class MappedDealsWriter {
+    private:
+        std::ofstream file;
+        std::vector<MappedDealsStorage::DayIndex> list_index;
+        uint64_t offset = 0;
+        bool is_error = false;
+
+        MappedDealsWriter(const MappedDealsWriter &) = delete;
+        MappedDealsWriter &operator = (const MappedDealsWriter &) = delete;
+
+    public:
+        MappedDealsWriter() {};
+
+        ~MappedDealsWriter() {
+            close();
+        }
+
+        /** \brief Открыть файл для записи
+         * \param path Путь к файлу
+         * \return Вернет 0 в случае успеха
+         */
+        int open(const std::string &path) {
+            close();
+            list_index.clear();
+            is_error = false;
+            file.open(path, std::ios::binary | std::ios::trunc);
+            if(!file) return NO_DATA_ACCESS;
+            /* заголовок будет перезаписан при закрытии файла */
+            MappedDealsStorage::Header header = {};
+            file.write((const char*)&header, sizeof(header));
+            offset = sizeof(header);
+            return OK;
+        }
+
+        /** \brief Добавить торговый день
+         * \param timestamp Метка времени дня
+         * \param deals Массив сделок
+         * \return Вернет 0 в случае успеха
+         */
+        int add_day(const xtime::timestamp_t timestamp, const std::vector<OneDealStruct> &deals) {
+            if(!file.is_open() || is_error) return NO_DATA_ACCESS;
+            const uint64_t day = xtime::get_first_timestamp_day(timestamp);
+            if(list_index.size() > 0 && list_index.back().timestamp >= day) return INVALID_PARAMETER;
+            MappedDealsStorage::DayIndex index;
+            index.timestamp = day;
+            index.offset = offset;
+            index.amount_deals = deals.size();
+            const size_t bytes = deals.size() * sizeof(OneDealStruct);
+            if(bytes > 0) file.write((const char*)deals.data(), bytes);
+            if(!file) {
+                is_error = true;
+                return NO_DATA_ACCESS;
+            }
+            list_index.push_back(index);
+            offset += bytes;
+            return OK;
+        }
+
+        /** \brief Завершить запись файла
+         *
+         * Дописывает индекс дней и заголовок. Пока файл не закрыт, он не может быть открыт для чтения
+         * \return Вернет 0 в случае успеха
+         */
+        int close() {
+            if(!file.is_open()) return OK;
+            if(!is_error) {
+                if(list_index.size() > 0) {
+                    file.write(
+                        (const char*)list_index.data(),
+                        list_index.size() * sizeof(MappedDealsStorage::DayIndex));
+                }
+                MappedDealsStorage::Header header;
+                header.magic = MappedDealsStorage::FILE_MAGIC;
+                header.version = MappedDealsStorage::FILE_VERSION;
+                header.record_size = sizeof(OneDealStruct);
+                header.amount_days = list_index.size();
+                header.index_offset = offset;
+                file.seekp(0);
+                file.write((const char*)&header, sizeof(header));
+                if(!file) is_error = true;
+            }
+            file.close();
+            return is_error ? NO_DATA_ACCESS : OK;
+        }
+    };
+};
+
+#endif // EASY_BO_MAPPED_STORAGE_HPP_INCLUDED
@@ -0,0 +1,188 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_STORAGE_DICTIONARY_HPP_INCLUDED
+#define EASY_BO_STORAGE_DICTIONARY_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "xquotes_daily_data_storage.hpp"
+#include "zstd.h"
+#include "dictBuilder/zdict.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <type_traits>
+
+namespace easy_bo {
+
+    /** \brief Признак хранилища, построенного на DailyDataStorage
+     *
+     * Такое хранилище сжимает каждый день отдельно и может использовать словарь zstd
+     */
+    template<class T>
+    struct is_daily_data_storage : std::false_type {};
+
+    template<class T>
+    struct is_daily_data_storage<xquotes_daily_data_storage::DailyDataStorage<T>> : std::true_type {
+        typedef T payload_type;     /**< Класс данных одного дня */
+    };
+
+    /** \brief Класс словаря zstd хранилища сделок
+     *
+     * Словарь хранится в файле <путь к хранилищу>.dict вместе с идентификатором словаря.
+     * Хранилище открывается с этим словарем автоматически, поэтому словарь нельзя
+     * заменить у хранилища, в котором уже есть дни: их нужно перенести в новое хранилище
+     * (см. DealsDataStoreTemplate::convert_from)
+     */
+    class DealsStorageDictionary {
+    public:
+        static const uint32_t FILE_MAGIC = 0x445A4245;  /**< Сигнатура файла "EBZD" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+        static const size_t DEFAULT_SIZE = 64 * 1024;   /**< Размер словаря по умолчанию */
+
+        /** \brief Получить путь к файлу словаря
+         * \param store_path Путь к хранилищу
+         * \return Путь к файлу словаря
+         */
+        static inline std::string get_path(const std::string &store_path) {
+            return store_path + ".dict";
+        }
+
+        /** \brief Получить идентификатор словаря
+         * \param dictionary Словарь
+         * \return Идентификатор словаря или 0, если словарь пуст или не обучен zstd
+         */
+        static inline uint32_t get_id(const std::string &dictionary) {
+            if(dictionary.empty()) return 0;
+            return ZDICT_getDictID(dictionary.data(), dictionary.size());
+        }
+
+        /** \brief Загрузить словарь хранилища
+         * \param store_path Путь к хранилищу
+         * \param dictionary Словарь
+         * \return Вернет 0 в случае успеха, NO_DATA_ACCESS если словаря нет
+         */
+        static int load(const std::string &store_path, std::string &dictionary) {
+            dictionary.clear();
+            std::ifstream file(get_path(store_path), std::ios::binary | std::ios::ate);
+            if(!file) return NO_DATA_ACCESS;
+            const std::streamoff file_size = file.tellg();
+            file.seekg(0);
+            uint32_t header[4] = {};
+            if(!file.read((char*)header, sizeof(header))) return PARSER_ERROR;
+            if(header[0] != FILE_MAGIC || header[1] != FILE_VERSION) return PARSER_ERROR;
+            /* размер словаря проверяется по размеру файла до выделения памяти */
+            if((uint64_t)header[3] > (uint64_t)file_size - sizeof(header)) return PARSER_ERROR;
+            std::string buffer(header[3], '\0');
+            if(buffer.size() > 0 && !file.read(&buffer[0], buffer.size())) return PARSER_ERROR;
+            if(get_id(buffer) != header[2]) return PARSER_ERROR;
+            dictionary.swap(buffer);
+            return OK;
+        }
+
+        /** \brief Загрузить словарь хранилища
+         * \param store_path Путь к хранилищу
+         * \return Словарь или пустая строка, если словаря нет
+         */
+        static std::string load(const std::string &store_path) {
+            std::string dictionary;
+            load(store_path, dictionary);
+            return dictionary;
+        }
+
+        /** \brief Записать словарь для нового хранилища
+         *
+         * Словарь можно записать только до создания файла хранилища
+         * \param store_path Путь к хранилищу
+         * \param dictionary Словарь
+         * \return Вернет 0 в случае успеха, INVALID_PARAMETER если хранилище уже существует
+         */
+        static int save(const std::string &store_path, const std::string &dictionary) {
+            {
+                std::ifstream store_file(store_path, std::ios::binary);
+                if(store_file) return INVALID_PARAMETER;
+            }
+            std::ofstream file(get_path(store_path), std::ios::binary | std::ios::trunc);
+            if(!file) return NO_DATA_ACCESS;
+            const uint32_t header[4] = {FILE_MAGIC, FILE_VERSION, get_id(dictionary), (uint32_t)dictionary.size()};
+            file.write((const char*)header, sizeof(header));
+            if(dictionary.size() > 0) file.write(dictionary.data(), dictionary.size());
+            return file ? OK : NO_DATA_ACCESS;
+        }
+
+        /** \brief Обучить словарь на образцах
+         * \param dictionary Словарь
+         * \param samples Образцы, записанные подряд
+         * \param samples_sizes Размеры образцов
+         * \param capacity Максимальный размер словаря
+         * \return Вернет 0 в случае успеха
+         */
+        static int train(
+                std::string &dictionary,
+                const std::string &samples,
+                const std::vector<size_t> &samples_sizes,
+                const size_t capacity = DEFAULT_SIZE) {
+            dictionary.clear();
+            if(samples_sizes.empty() || capacity == 0) return NO_DATA_ACCESS;
+            std::string buffer(capacity, '\0');
+            const size_t size = ZDICT_trainFromBuffer(
+                &buffer[0],
+                buffer.size(),
+                samples.data(),
+                samples_sizes.data(),
+                samples_sizes.size());
+            if(ZDICT_isError(size)) return UNKNOWN_ERROR;
+            buffer.resize(size);
+            dictionary.swap(buffer);
+            return OK;
+        }
+    };
+
+    /** \brief Класс хранилища дней, открытого со словарем
+     *
+     * Передает словарь в конструктор хранилища, построенного на DailyDataStorage.
+     * Остальные хранилища открываются без словаря
+     */
+    template<class STORAGE_TYPE>
+    class DictionaryStorage : public STORAGE_TYPE {
+    public:
+
+        /** \brief Открыть хранилище
+         * \param path Путь к хранилищу
+         * \param dictionary Словарь, должен существовать, пока открыто хранилище
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<is_daily_data_storage<T>::value>::type* = nullptr>
+        DictionaryStorage(const std::string &path, const std::string &dictionary) :
+            STORAGE_TYPE(path, dictionary.empty() ? NULL : dictionary.data(), dictionary.size()) {};
+
+        /** \brief Открыть хранилище
+         * \param path Путь к хранилищу
+         * \param dictionary Не используется
+         */
+        template<class T = STORAGE_TYPE, typename std::enable_if<!is_daily_data_storage<T>::value>::type* = nullptr>
+        DictionaryStorage(const std::string &path, const std::string &/* dictionary */) :
+            STORAGE_TYPE(path) {};
+    };
+};
+
+#endif // EASY_BO_STORAGE_DICTIONARY_HPP_INCLUDED
@@ -0,0 +1,226 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_SYMBOL_CATALOG_HPP_INCLUDED
+#define EASY_BO_SYMBOL_CATALOG_HPP_INCLUDED
+
+#include "easy_bo_common.hpp"
+#include "easy_bo_fast_storage.hpp"
+#include <vector>
+#include <map>
+#include <set>
+#include <list>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace easy_bo {
+
+    /** \brief Класс каталога символов хранилища
+     *
+     * Для каждой пары имени и индекса символа хранит первый и последний день со сделками
+     * и количество сделок. Каталог обновляется при записи каждого дня, поэтому
+     * список символов хранилища можно получить без чтения сделок.
+     * При удалении сделок границы дней символа не сужаются.
+     */
+    class SymbolCatalog {
+    public:
+        static const uint32_t FILE_MAGIC = 0x43534245;  /**< Сигнатура файла "EBSC" */
+        static const uint32_t FILE_VERSION = 1;         /**< Версия формата */
+
+        /** \brief Запись каталога
+         */
+        class Entry {
+        public:
+            int8_t name[NAME_SIZE] = {};        /**< Имя символа */
+            uint64_t first_day = 0;             /**< Метка времени первого дня со сделками */
+            uint64_t last_day = 0;              /**< Метка времени последнего дня со сделками */
+            uint64_t amount_deals = 0;          /**< Количество сделок */
+            uint8_t symbol = 0;                 /**< Индекс символа */
+            uint8_t reserved[7] = {};           /**< Не используется, обнулен */
+
+            Entry() {};
+
+            /** \brief Получить имя символа
+             * \return Имя символа
+             */
+            std::string get_name() const {
+                const int8_t *name_end = std::find(name, name + NAME_SIZE, 0);
+                return std::string((const char*)name, name_end - name);
+            }
+        };
+
+    private:
+        std::map<std::string, Entry> entries;  /**< Записи по имени и индексу символа */
+        bool is_modified = false;
+
+        static inline std::string get_key(const OneDealStruct &deal) {
+            std::string key((const char*)deal.name, NAME_SIZE);
+            key.push_back((char)deal.symbol);
+            return key;
+        }
+
+    public:
+        SymbolCatalog() {};
+
+        inline size_t size() const {return entries.size();};
+        inline bool modified() const {return is_modified;};
+
+        /** \brief Очистить каталог
+         */
+        void clear() {
+            entries.clear();
+            is_modified = true;
+        }
+
+        /** \brief Учесть сделки дня
+         * \param deals Сделки дня
+         * \param timestamp Метка времени дня
+         */
+        void add_day(const std::vector<OneDealStruct> &deals, const xtime::timestamp_t timestamp) {
+            const uint64_t day = xtime::get_first_timestamp_day(timestamp);
+            for(size_t i = 0; i < deals.size(); ++i) {
+                auto it = entries.find(get_key(deals[i]));
+                if(it == entries.end()) {
+                    Entry entry;
+                    std::memcpy(entry.name, deals[i].name, NAME_SIZE);
+                    entry.symbol = deals[i].symbol;
+                    entry.first_day = day;
+                    entry.last_day = day;
+                    it = entries.insert(std::make_pair(get_key(deals[i]), entry)).first;
+                }
+                Entry &entry = it->second;
+                entry.first_day = std::min(entry.first_day, day);
+                entry.last_day = std::max(entry.last_day, day);
+                ++entry.amount_deals;
+            }
+            if(deals.size() > 0) is_modified = true;
+        }
+
+        /** \brief Исключить сделки дня
+         *
+         * Символы, у которых не осталось сделок, удаляются из каталога
+         * \param deals Сделки дня, которые были удалены или перезаписаны
+         */
+        void remove_day(const std::vector<OneDealStruct> &deals) {
+            for(size_t i = 0; i < deals.size(); ++i) {
+                auto it = entries.find(get_key(deals[i]));
+                if(it == entries.end()) continue;
+                if(it->second.amount_deals > 1) --it->second.amount_deals;
+                else entries.erase(it);
+            }
+            if(deals.size() > 0) is_modified = true;
+        }
+
+        /** \brief Получить записи каталога
+         * \return Массив записей, упорядоченный по имени и индексу символа
+         */
+        std::vector<Entry> get_entries() const {
+            std::vector<Entry> list_entries;
+            list_entries.reserve(entries.size());
+            for(auto it = entries.begin(); it != entries.end(); ++it) {
+                list_entries.push_back(it->second);
+            }
+            return list_entries;
+        }
+
+        /** \brief Получить упорядоченный список имен символов
+         * \return Список имен символов
+         */
+        std::list<std::string> get_list_names() const {
+            std::set<std::string> names;
+            for(auto it = entries.begin(); it != entries.end(); ++it) {
+                names.insert(it->second.get_name());
+            }
+            return std::list<std::string>(names.begin(), names.end());
+        }
+
+        /** \brief Получить упорядоченный список индексов символов
+         * \return Список индексов символов
+         */
+        template<class T>
+        std::list<T> get_list_indexes() const {
+            std::set<T> indexes;
+            for(auto it = entries.begin(); it != entries.end(); ++it) {
+                indexes.insert(it->second.symbol);
+            }
+            return std::list<T>(indexes.begin(), indexes.end());
+        }
+
+        /** \brief Загрузить каталог из файла
+         * \param path Путь к файлу каталога
+         * \return Вернет 0 в случае успеха
+         */
+        int load(const std::string &path) {
+            entries.clear();
+            is_modified = false;
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if(!file) return NO_DATA_ACCESS;
+            const std::streamoff file_size = file.tellg();
+            file.seekg(0);
+            uint32_t header[3] = {};
+            if(!file.read((char*)header, sizeof(header))) return PARSER_ERROR;
+            if(header[0] != FILE_MAGIC || header[1] != FILE_VERSION) return PARSER_ERROR;
+            /* количество записей проверяется по размеру файла до выделения памяти */
+            if((uint64_t)header[2] * sizeof(Entry) > (uint64_t)file_size - sizeof(header)) return PARSER_ERROR;
+            std::vector<Entry> list_entries(header[2]);
+            if(list_entries.size() > 0 &&
+                !file.read((char*)list_entries.data(), list_entries.size() * sizeof(Entry))) return PARSER_ERROR;
+            for(size_t i = 0; i < list_entries.size(); ++i) {
+                OneDealStruct deal;
+                std::memcpy(deal.name, list_entries[i].name, NAME_SIZE);
+                deal.symbol = list_entries[i].symbol;
+                entries[get_key(deal)] = list_entries[i];
+            }
+            return OK;
+        }
+
+        /** \brief Записать каталог в файл
+         *
+         * Каталог записывается во временный файл, который затем заменяет старый
+         * \param path Путь к файлу каталога
+         * \return Вернет 0 в случае успеха
+         */
+        int save(const std::string &path) {
+            const std::string temp_path = path + ".tmp";
+            {
+                std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+                if(!file) return NO_DATA_ACCESS;
+                const uint32_t header[3] = {FILE_MAGIC, FILE_VERSION, (uint32_t)entries.size()};
+                file.write((const char*)header, sizeof(header));
+                for(auto it = entries.begin(); it != entries.end(); ++it) {
+                    file.write((const char*)&it->second, sizeof(Entry));
+                }
+                if(!file) return NO_DATA_ACCESS;
+            }
+            std::remove(path.c_str());
+            if(std::rename(temp_path.c_str(), path.c_str()) != 0) return NO_DATA_ACCESS;
+            is_modified = false;
+            return OK;
+        }
+    };
+};
+
+#endif // EASY_BO_SYMBOL_CATALOG_HPP_INCLUDED
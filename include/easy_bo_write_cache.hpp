@@ -0,0 +1,221 @@
+/*
+* easy_bo_tester - C++ header-only library for testing binary options
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef EASY_BO_WRITE_CACHE_HPP_INCLUDED
+#define EASY_BO_WRITE_CACHE_HPP_INCLUDED
+
+#include "easy_bo_fast_storage.hpp"
+#include "easy_bo_deals_hash_set.hpp"
+#include <vector>
+#include <list>
+#include <map>
+
+namespace easy_bo {
+
+    /** \brief Класс буфера записи одного торгового дня
+     *
+     * Содержит новые сделки дня, еще не записанные в хранилище, и уже записанные сделки этого дня,
+     * которые читаются из хранилища один раз для проверки повторов и слияния
+     */
+    class DealsWriteDay {
+    public:
+        xtime::timestamp_t timestamp = 0;               /**< Метка времени начала дня */
+        std::vector<OneDealStruct> list_deals;          /**< Новые сделки дня */
+        std::vector<OneDealStruct> list_stored_deals;   /**< Уже записанные в хранилище сделки дня */
+        DealsHashSet deals_set;                         /**< Отпечатки записанных и новых сделок */
+        bool is_sorted = true;                          /**< Флаг отсортированности новых сделок */
+        bool is_loaded = false;                         /**< Флаг загрузки записанных сделок */
+
+        DealsWriteDay() {};
+
+        /** \brief Получить сделку по индексу во множестве отпечатков
+         * \param index Индекс: сначала идут записанные сделки, затем новые
+         * \return Сделка
+         */
+        inline const OneDealStruct &get_deal(const uint32_t index) const {
+            return index < list_stored_deals.size() ?
+                list_stored_deals[index] : list_deals[index - list_stored_deals.size()];
+        }
+
+        /** \brief Добавить сделку во множество отпечатков
+         * \param deal Сделка
+         * \param index Индекс сделки (см. get_deal)
+         * \return Вернет false, если сделка повторяется
+         */
+        inline bool insert(const OneDealStruct &deal, const size_t index) {
+            return deals_set.insert(deal, (uint32_t)index,
+                [this](const uint32_t deal_index) -> const OneDealStruct& {
+                    return get_deal(deal_index);
+                });
+        }
+
+        /** \brief Построить множество отпечатков и удалить повторы из новых сделок
+         *
+         * Вызывается после загрузки записанных сделок. Повторы среди записанных сделок остаются,
+         * из повторяющихся новых сделок остается первая
+         * \return Количество удаленных сделок
+         */
+        size_t unique() {
+            deals_set.clear();
+            deals_set.reserve(list_stored_deals.size() + list_deals.size());
+            for(size_t i = 0; i < list_stored_deals.size(); ++i) {
+                insert(list_stored_deals[i], i);
+            }
+            size_t index = 0;
+            for(size_t i = 0; i < list_deals.size(); ++i) {
+                if(!insert(list_deals[i], list_stored_deals.size() + index)) continue;
+                if(index != i) list_deals[index] = list_deals[i];
+                ++index;
+            }
+            const size_t repeat_deals = list_deals.size() - index;
+            list_deals.resize(index);
+            return repeat_deals;
+        }
+
+        /** \brief Добавить новую сделку без проверки на повтор
+         * \param deal Сделка
+         */
+        inline void add_deal(const OneDealStruct &deal) {
+            /* сортировка откладывается до записи дня */
+            if(list_deals.size() > 0 && deal.timestamp < list_deals.back().timestamp) is_sorted = false;
+            list_deals.push_back(deal);
+        }
+
+        /** \brief Сбросить загруженные записанные сделки
+         */
+        inline void reset() {
+            list_stored_deals.clear();
+            deals_set.clear();
+            is_loaded = false;
+        }
+    };
+
+    /** \brief Класс буфера записи нескольких торговых дней
+     *
+     * Хранит буферы записи дней, в которые пишутся сделки. Количество дней ограничено,
+     * при переполнении вытесняется день, к которому дольше всего не обращались.
+     * Сам буфер не обращается к хранилищу: вытесняемый день записывает владелец буфера
+     */
+    class DealsWriteCache {
+    public:
+        static const size_t DEFAULT_MAX_DAYS = 16;  /**< Количество дней по умолчанию */
+
+    private:
+        std::list<DealsWriteDay> list_days; /**< Дни, в начале списка последние использованные */
+        std::map<xtime::timestamp_t, std::list<DealsWriteDay>::iterator> days_index;
+        size_t max_days = DEFAULT_MAX_DAYS;
+
+    public:
+        DealsWriteCache() {};
+
+        /** \brief Установить максимальное количество дней
+         *
+         * Лишние дни не вытесняются сразу, см. is_full
+         * \param days Количество дней, не меньше 1
+         */
+        inline void set_max_days(const size_t days) {
+            max_days = days == 0 ? 1 : days;
+        }
+
+        inline size_t get_max_days() const {return max_days;};
+        inline size_t size() const {return list_days.size();};
+        inline bool empty() const {return list_days.empty();};
+
+        /** \brief Проверить, нужно ли вытеснить день перед добавлением нового
+         * \return Вернет true, если дней не меньше максимального количества
+         */
+        inline bool is_full() const {
+            return list_days.size() >= max_days;
+        }
+
+        /** \brief Найти буфер дня
+         * \param timestamp Метка времени начала дня
+         * \return Указатель на буфер дня или NULL
+         */
+        DealsWriteDay *find(const xtime::timestamp_t timestamp) {
+            /* сделки обычно идут в последний использованный день */
+            if(!list_days.empty() && list_days.front().timestamp == timestamp) return &list_days.front();
+            auto it = days_index.find(timestamp);
+            if(it == days_index.end()) return NULL;
+            list_days.splice(list_days.begin(), list_days, it->second);
+            return &list_days.front();
+        }
+
+        /** \brief Проверить наличие дня
+         *
+         * В отличие от find не меняет порядок вытеснения
+         * \param timestamp Метка времени начала дня
+         * \return Вернет true, если день есть в буфере
+         */
+        inline bool check(const xtime::timestamp_t timestamp) const {
+            return days_index.find(timestamp) != days_index.end();
+        }
+
+        /** \brief Добавить буфер дня
+         * \param timestamp Метка времени начала дня, дня не должно быть в буфере
+         * \return Буфер дня
+         */
+        DealsWriteDay &insert(const xtime::timestamp_t timestamp) {
+            list_days.push_front(DealsWriteDay());
+            list_days.front().timestamp = timestamp;
+            days_index[timestamp] = list_days.begin();
+            return list_days.front();
+        }
+
+        /** \brief Получить день, к которому дольше всего не обращались
+         * \return Буфер дня, буфер не должен быть пуст
+         */
+        inline DealsWriteDay &get_oldest() {
+            return list_days.back();
+        }
+
+        /** \brief Получить день с наименьшей меткой времени
+         * \return Буфер дня, буфер не должен быть пуст
+         */
+        inline DealsWriteDay &get_first() {
+            return *days_index.begin()->second;
+        }
+
+        /** \brief Удалить буфер дня
+         * \param timestamp Метка времени начала дня
+         */
+        void erase(const xtime::timestamp_t timestamp) {
+            auto it = days_index.find(timestamp);
+            if(it == days_index.end()) return;
+            list_days.erase(it->second);
+            days_index.erase(it);
+        }
+
+        /** \brief Получить все новые сделки буфера
+         * \param list_deals Массив сделок по возрастанию дней
+         */
+        void get_deals(std::vector<OneDealStruct> &list_deals) const {
+            list_deals.clear();
+            for(auto it = days_index.begin(); it != days_index.end(); ++it) {
+                list_deals.insert(list_deals.end(), it->second->list_deals.begin(), it->second->list_deals.end());
+            }
+        }
+    };
+};
+
+#endif // EASY_BO_WRITE_CACHE_HPP_INCLUDED